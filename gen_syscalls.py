@@ -0,0 +1,226 @@
+# Lrix
+# Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+#
+# This program is released under the terms of the GNU General Public License version 2(GPLv2).
+# See https://opensource.org/licenses/GPL-2.0 for more information.
+#
+# Project homepage: https://github.com/lrisguan/Lrix
+# Description: A scratch implemention of OS based on RISC-V
+
+#!/usr/bin/env python3
+"""
+Generate the syscall headers from kernel/syscall/syscall.tbl.
+
+This script reads the syscall list and emits:
+
+    kernel/syscall/syscall_nr.h     SYS_* numbers and NR_SYSCALLS (included by syscall.h)
+    kernel/syscall/syscall_table.h  handler prototypes and the dispatch table (syscall.c)
+    usr/usyscall.h                  static inline sys_*() wrappers (included by user.h)
+
+Usage (from project root):
+
+    python3 gen_syscalls.py
+
+The kernel Makefile runs it whenever syscall.tbl or this script changes. Files are
+only rewritten when their contents change.
+"""
+
+import pathlib
+import re
+import sys
+
+ROOT = pathlib.Path(__file__).parent
+TBL = ROOT / "kernel" / "syscall" / "syscall.tbl"
+OUT_NR = ROOT / "kernel" / "syscall" / "syscall_nr.h"
+OUT_TABLE = ROOT / "kernel" / "syscall" / "syscall_table.h"
+OUT_USER = ROOT / "usr" / "usyscall.h"
+
+MAX_ARGS = 6
+FLAGS = {"noreturn": "SYSF_NORETURN", "setpc": "SYSF_SETPC", "block": "SYSF_BLOCK"}
+
+LICENSE = ("/*\n"
+           " * Lrix\n"
+           " * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>\n"
+           " * \n"
+           " * This program is released under the terms of the GNU General Public License version 2(GPLv2). \n"
+           " * See https://opensource.org/licenses/GPL-2.0 for more information. \n"
+           " * \n"
+           " * Project homepage: https://github.com/lrisguan/Lrix \n"
+           " * Description: A scratch implemention of OS based on RISC-V \n"
+           " */\n\n"
+           "/*\n"
+           " * Auto-generated from kernel/syscall/syscall.tbl by gen_syscalls.py,\n"
+           " * do not edit manually.\n"
+           " */\n\n")
+
+PROTO_RE = re.compile(r"^(?P<ret>.*?[\s*])(?P<name>[A-Za-z_]\w*)\s*\((?P<args>.*)\)$")
+
+
+class Syscall:
+    def __init__(self, nr, flags, ret, name, args, doc):
+        self.nr = nr
+        self.flags = flags
+        self.ret = ret
+        self.name = name
+        self.args = args  # list of (type, name)
+        self.doc = doc
+
+    @property
+    def macro(self):
+        return "SYS_" + self.name.upper()
+
+
+def fail(lineno, msg):
+    sys.exit(f"{TBL}:{lineno}: {msg}")
+
+
+def parse_arg(lineno, text):
+    m = re.match(r"^(.*?[\s*])([A-Za-z_]\w*)$", text.strip())
+    if not m:
+        fail(lineno, f"cannot parse argument '{text.strip()}'")
+    return m.group(1).strip(), m.group(2)
+
+
+def parse():
+    calls = []
+    doc = []
+    for lineno, line in enumerate(TBL.read_text(encoding="utf-8").splitlines(), 1):
+        line = line.strip()
+        if not line:
+            doc = []
+            continue
+        if line.startswith("#"):
+            doc.append(line[1:].strip())
+            continue
+
+        fields = line.split(None, 2)
+        if len(fields) != 3 or not fields[0].isdigit():
+            fail(lineno, "expected '<nr> <flags> <prototype>'")
+        nr, flags, proto = int(fields[0]), fields[1], fields[2]
+
+        flag_macros = []
+        if flags != "-":
+            for f in flags.split("|"):
+                if f not in FLAGS:
+                    fail(lineno, f"unknown flag '{f}'")
+                flag_macros.append(FLAGS[f])
+
+        m = PROTO_RE.match(proto)
+        if not m:
+            fail(lineno, f"cannot parse prototype '{proto}'")
+        args_text = m.group("args").strip()
+        args = []
+        if args_text != "void":
+            args = [parse_arg(lineno, a) for a in args_text.split(",")]
+        if len(args) > MAX_ARGS:
+            fail(lineno, f"{m.group('name')}: more than {MAX_ARGS} arguments")
+
+        call = Syscall(nr, flag_macros, m.group("ret").strip(), m.group("name"), args, doc)
+        for other in calls:
+            if other.nr == nr or other.name == call.name:
+                fail(lineno, f"{call.name}: duplicate number or name")
+        calls.append(call)
+        doc = []
+    return sorted(calls, key=lambda c: c.nr)
+
+
+def wrap(head, items, tail):
+    """head + items joined by ', ' + tail, wrapped at 100 columns under the '('."""
+    lines, cur = [], head
+    for i, item in enumerate(items):
+        piece = item + ("," if i < len(items) - 1 else tail)
+        if cur != head and not cur.endswith("(") and len(cur) + 1 + len(piece) > 100:
+            lines.append(cur)
+            cur = " " * len(head) + piece
+        else:
+            cur += ("" if cur == head else " ") + piece
+    if not items:
+        cur += tail
+    return "\n".join(lines + [cur]) + "\n"
+
+
+def comment(doc):
+    return "".join(f"// {d}\n" if d else "//\n" for d in doc)
+
+
+def gen_nr(calls):
+    out = [LICENSE, "#ifndef _SYSCALL_NR_H_\n#define _SYSCALL_NR_H_\n\n"]
+    for c in calls:
+        out.append(f"#define {c.macro} {c.nr}\n")
+    out.append("\n// size of the syscall table (highest syscall number + 1)\n")
+    out.append(f"#define NR_SYSCALLS {calls[-1].nr + 1}\n\n")
+    out.append("#endif /* _SYSCALL_NR_H_ */\n")
+    return "".join(out)
+
+
+def gen_table(calls):
+    out = [LICENSE, "// included by syscall.c only, after struct syscall_desc\n\n"]
+    for c in calls:
+        out.append(f"static uint64_t sys_{c.name}(uint64_t args[6], uint64_t epc);\n")
+    out.append("\nstatic const struct syscall_desc syscall_table[NR_SYSCALLS] = {\n")
+    for c in calls:
+        flags = " | ".join(c.flags) if c.flags else "0"
+        out.append(f"    [{c.macro}] = {{sys_{c.name}, \"{c.name}\", {len(c.args)}, {flags}}},\n")
+    out.append("};\n")
+    return "".join(out)
+
+
+def gen_callers():
+    out = []
+    for n in range(MAX_ARGS + 1):
+        params = ["uint64_t num"] + [f"uint64_t a{i}" for i in range(n)]
+        out.append(wrap(f"static inline uint64_t sys_call{n}(", params, ") {"))
+        if n == 0:
+            out.append("  register uint64_t r0 asm(\"a0\");\n")
+        for i in range(n):
+            out.append(f"  register uint64_t r{i} asm(\"a{i}\") = a{i};\n")
+        out.append("  register uint64_t r7 asm(\"a7\") = num;\n")
+        inputs = "".join(f"\"r\"(r{i}), " for i in range(1, n)) + "\"r\"(r7)"
+        output = f"\"{'=' if n == 0 else '+'}r\"(r0)"
+        asm = f"  asm volatile(\"ecall\" : {output} : {inputs} : \"memory\");"
+        if len(asm) > 100:
+            pad = " " * len("  asm volatile(")
+            asm = (f"  asm volatile(\"ecall\"\n{pad}: {output}\n{pad}: {inputs}\n"
+                   f"{pad}: \"memory\");")
+        out.append(asm + "\n")
+        out.append("  return r0;\n}\n\n")
+    return "".join(out)
+
+
+def gen_user(calls):
+    out = [LICENSE,
+           "// user-space syscall wrappers, included by user.h (which provides the types)\n\n",
+           "#ifndef _USYSCALL_H_\n#define _USYSCALL_H_\n\n",
+           "#include <stdint.h>\n\n",
+           "// raw ecall with n arguments in a0..a(n-1), number in a7, result in a0\n",
+           gen_callers()]
+    for c in calls:
+        params = [f"{t}{'' if t.endswith('*') else ' '}{n}" for t, n in c.args] or ["void"]
+        casts = [c.macro] + [f"(uint64_t){n}" for _, n in c.args]
+        ret = c.ret + ("" if c.ret.endswith("*") else " ")
+        out.append(comment(c.doc))
+        out.append(wrap(f"static inline {ret}sys_{c.name}(", params, ") {"))
+        if c.ret == "void":
+            out.append(wrap(f"  (void)sys_call{len(c.args)}(", casts, ");"))
+        else:
+            out.append(wrap(f"  return ({c.ret})sys_call{len(c.args)}(", casts, ");"))
+        out.append("}\n\n")
+    out.append("#endif /* _USYSCALL_H_ */\n")
+    return "".join(out)
+
+
+def write_if_changed(path, text):
+    if path.exists() and path.read_text(encoding="utf-8") == text:
+        return
+    path.write_text(text, encoding="utf-8")
+
+
+def main() -> None:
+    calls = parse()
+    write_if_changed(OUT_NR, gen_nr(calls))
+    write_if_changed(OUT_TABLE, gen_table(calls))
+    write_if_changed(OUT_USER, gen_user(calls))
+
+
+if __name__ == "__main__":
+    main()
@@ -13,6 +13,59 @@
 
 #include "blk.h"
 #include "../include/log.h"
+#include "../include/riscv.h"
+#include "../proc/proc.h"
+#include "../string/string.h"
+
+// --- Global state ---
+
+static volatile uint32_t *mmio = NULL;
+// virtio-mmio version: 1 (legacy) or 2 (modern)
+static uint32_t device_version = 0;
+
+// ring layout for a queue of n entries (virtio 1.0 2.6.2, legacy alignment 4096)
+#define VQ_ALIGN(x) (((x) + 4095) & ~(uintptr_t)4095)
+#define VQ_AVAIL_OFF(n) (sizeof(struct virtq_desc) * (n))
+#define VQ_USED_OFF(n) VQ_ALIGN(VQ_AVAIL_OFF(n) + sizeof(struct virtq_avail) + 2 * (n) + 2)
+#define VQ_SIZE(n) (VQ_USED_OFF(n) + sizeof(struct virtq_used) + 8 * (n) + 2)
+
+static uint8_t vq_mem[VQ_ALIGN(VQ_SIZE(BLK_QUEUE_MAX))] __attribute__((aligned(4096)));
+static struct virtq_desc *desc;
+static struct virtq_avail *avail;
+static volatile struct virtq_used *used;
+static uint16_t queue_num;      // negotiated queue size
+static uint16_t free_head;      // free descriptors, linked through desc[].next
+static uint16_t num_free;
+static uint16_t last_used_idx;  // used ring entries already collected
+static int kick_pending;        // avail.idx moved since the last notify
+static int seg_max;             // data descriptors per request
+static uint32_t size_max;       // bytes per data descriptor, whole sectors
+static int event_idx;           // VIRTIO_RING_F_EVENT_IDX negotiated
+static int indirect;            // VIRTIO_RING_F_INDIRECT_DESC negotiated
+static uint16_t kicked_idx;     // avail.idx at the last notify
+static int nsleep;              // requests whose waiter sleeps for the interrupt
+
+// EVENT_IDX fields right behind the rings: interrupt once used.idx passes used_event,
+// notify once avail.idx passes avail_event
+#define VQ_USED_EVENT (*(volatile uint16_t *)&avail->ring[queue_num])
+#define VQ_AVAIL_EVENT (*(volatile uint16_t *)((volatile char *)used->ring + 8 * queue_num))
+
+// with indirect descriptors every request keeps its chain here, in one ring slot
+static struct virtq_desc ind_tab[BLK_QUEUE_MAX][BLK_SEG_MAX + 2] __attribute__((aligned(16)));
+
+// notifies and interrupts per BLK_STATS_WINDOW completed requests
+#define BLK_STATS_WINDOW 1000
+static struct {
+  uint32_t reqs, notifies, intrs;
+} stats;
+
+static struct blk_request reqs[BLK_QUEUE_MAX];
+static waitqueue req_wq[BLK_QUEUE_MAX]; // owner of reqs[i] sleeping until it is done
+
+// longest blk_wait spins before it sleeps, in mtime ticks (50 us)
+#define BLK_SPIN_MAX (MTIME_FREQ / 20000)
+// request latency (submit to completion), moving average over ~8 requests, times 8
+static uint64_t lat_avg8;
 
 // --- Helper functions ---
 
@@ -27,9 +80,110 @@ static inline uint32_t mmio_read(uint32_t off) {
   return 0;
 }
 
+// --- Descriptor free list ---
+
+static int desc_alloc(void) {
+  if (num_free == 0)
+    return -1;
+  uint16_t d = free_head;
+  free_head = desc[d].next;
+  num_free--;
+  return d;
+}
+
+static void desc_free_chain(uint16_t head) {
+  for (;;) {
+    uint16_t flags = desc[head].flags;
+    uint16_t next = desc[head].next;
+    desc[head].next = free_head;
+    free_head = head;
+    num_free++;
+    if (!(flags & VRING_DESC_F_NEXT))
+      break;
+    head = next;
+  }
+}
+
+// the device has to signal once its index moves from old to new past event (virtio 2.6.7)
+static inline int vq_need_event(uint16_t event, uint16_t new_idx, uint16_t old_idx) {
+  return (uint16_t)(new_idx - event - 1) < (uint16_t)(new_idx - old_idx);
+}
+
+// interrupt once the used ring entry idx is written (without EVENT_IDX: on every one)
+static void intr_want(uint16_t idx) {
+  if (event_idx)
+    VQ_USED_EVENT = idx;
+  else
+    avail->flags = 0;
+}
+
+// no interrupts while nobody sleeps: spinning and polling waiters reap by themselves
+static void intr_mute(void) {
+  if (event_idx)
+    VQ_USED_EVENT = (uint16_t)(last_used_idx - 1); // a full index wrap away
+  else
+    avail->flags = VRING_AVAIL_F_NO_INTERRUPT;
+}
+
+static void stats_request(void) {
+  if (++stats.reqs < BLK_STATS_WINDOW)
+    return;
+#ifdef BLK_STATS
+  printk(BLUE "[INFO]: \tblk: per %d requests: %d notifies, %d interrupts" RESET "\n",
+         BLK_STATS_WINDOW, stats.notifies, stats.intrs);
+#endif
+  memset(&stats, 0, sizeof(stats));
+}
+
+// mark every chain the device has returned since the last call and wake its owner;
+// completions are matched by the head descriptor id, in whatever order the device
+// finishes them. Runs with interrupts off. Returns how many sleepers were woken
+static int blk_reap(void) {
+  int woken = 0;
+  __sync_synchronize();
+  while (last_used_idx != used->idx) {
+    uint32_t id = used->ring[last_used_idx % queue_num].id;
+    if (id < queue_num && reqs[id].busy) {
+      struct blk_request *r = &reqs[id];
+      uint64_t lat = read_mtime() - r->submitted;
+      lat_avg8 += lat - lat_avg8 / 8;
+      r->done = 1;
+      if (r->sleeping) {
+        r->sleeping = 0;
+        nsleep--;
+      }
+      woken += proc_wakeup(&req_wq[id], -1);
+      stats_request();
+    }
+    last_used_idx++;
+  }
+  // sleepers left: their requests may finish in any order, so take the next completion
+  if (nsleep > 0)
+    intr_want(last_used_idx);
+  else
+    intr_mute();
+  return woken;
+}
+
+// notify the device of new avail entries, unless it said it does not need to hear
+static void blk_kick(void) {
+  if (!kick_pending)
+    return;
+  kick_pending = 0;
+  __sync_synchronize(); // avail.idx out before reading what the device asked for
+  uint16_t new_idx = avail->idx;
+  uint16_t old_idx = kicked_idx;
+  kicked_idx = new_idx;
+  if (event_idx ? !vq_need_event(VQ_AVAIL_EVENT, new_idx, old_idx)
+                : (used->flags & VRING_USED_F_NO_NOTIFY))
+    return;
+  stats.notifies++;
+  mmio_write(VIRTIO_MMIO_QUEUE_NOTIFY, 0);
+}
+
 // --- Interrupt handler (exported for trap.c) ---
 
-// Return 1 if this interrupt is handled by the block device, 0 otherwise.
+// Return how many waiting processes the completions woke (0 if none or not ours).
 int blk_intr(void) {
   if (!mmio)
     return 0;
@@ -41,79 +195,258 @@ int blk_intr(void) {
 
   // 2. Acknowledge interrupt (ACK)
   mmio_write(VIRTIO_MMIO_INTERRUPT_ACK, status & 0x3);
+  stats.intrs++;
 
-  // 3. Let blk_do_io() notice completion by polling used.idx
-  __sync_synchronize();
-  if (blk_virtq.used.idx != last_used_idx) {
-    return 1;
-  }
-
-  return 0;
+  // 3. Collect the finished requests and wake their waiters
+  return blk_reap();
 }
 
-// --- IO operations (interrupt-driven) ---
-
-static int blk_do_io(uint32_t type, uint64_t sector, void *buf) {
-  if (!mmio)
-    return -1;
-
-  // Use spinlock to prevent concurrent request submissions from corrupting descriptors
-  // acquire(&blk_lock);
+// --- IO operations ---
 
-  blk_req.type = type;
-  blk_req.reserved = 0;
-  blk_req.sector = sector;
-  blk_status = 0xff;
+static void desc_set(struct virtq_desc *d, void *addr, uint32_t len, uint16_t flags) {
+  d->addr = (uint64_t)V2P(addr);
+  d->len = len;
+  d->flags = flags;
+  d->next = 0;
+}
 
-  // 1. Prepare descriptors
-  uintptr_t buf_pa = V2P(buf);
-  uintptr_t req_pa = V2P(&blk_req);
-  uintptr_t status_pa = V2P(&blk_status);
+int blk_seg_max(void) { return seg_max; }
+uint32_t blk_size_max(void) { return size_max; }
 
-  // 1. Fill descriptor chain: req -> data -> status
-  blk_virtq.desc[0].addr = (uint64_t)req_pa;
-  blk_virtq.desc[0].len = sizeof(blk_req);
-  blk_virtq.desc[0].flags = VRING_DESC_F_NEXT;
-  blk_virtq.desc[0].next = 1;
+struct blk_request *blk_submit(uint32_t type, uint64_t sector, const struct blk_sg *sg, int nsg,
+                               int flags) {
+  int on = intr_save(); // the free list and avail ring are shared by all submitters
+  if (!mmio || nsg < 1 || nsg > seg_max || num_free < (indirect ? 1 : nsg + 2)) {
+    intr_restore(on);
+    return NULL;
+  }
 
-  blk_virtq.desc[1].addr = (uint64_t)buf_pa;
-  blk_virtq.desc[1].len = 512;
-  blk_virtq.desc[1].flags =
+  // 1. Fill a descriptor chain req -> data... -> status, in the request's indirect
+  // table (one ring slot) or from the free list
+  int head = desc_alloc();
+  struct blk_request *r = &reqs[head];
+  r->hdr.type = type;
+  r->hdr.reserved = 0;
+  r->hdr.sector = sector;
+  r->status = 0xff;
+  r->done = 0;
+  r->busy = 1;
+  r->flags = (uint8_t)flags;
+  r->sleeping = 0;
+  r->submitted = read_mtime();
+
+  uint16_t dflags =
       (type == VIRTIO_BLK_T_IN) ? (VRING_DESC_F_NEXT | VRING_DESC_F_WRITE) : VRING_DESC_F_NEXT;
-  blk_virtq.desc[1].next = 2;
-
-  blk_virtq.desc[2].addr = (uint64_t)status_pa;
-  blk_virtq.desc[2].len = 1;
-  blk_virtq.desc[2].flags = VRING_DESC_F_WRITE;
-  blk_virtq.desc[2].next = 0;
-
-  // 2. Put descriptor chain into avail ring
-  uint16_t aidx = blk_virtq.avail.idx;
-  blk_virtq.avail.ring[aidx % 8] = 0; // head desc index
+  if (indirect) {
+    struct virtq_desc *t = ind_tab[head];
+    desc_set(&t[0], &r->hdr, sizeof(r->hdr), VRING_DESC_F_NEXT);
+    for (int i = 0; i < nsg; i++)
+      desc_set(&t[i + 1], sg[i].addr, sg[i].len, dflags);
+    desc_set(&t[nsg + 1], (void *)&r->status, 1, VRING_DESC_F_WRITE);
+    for (int i = 0; i <= nsg; i++)
+      t[i].next = (uint16_t)(i + 1);
+    desc_set(&desc[head], t, (uint32_t)((nsg + 2) * sizeof(*t)), VRING_DESC_F_INDIRECT);
+  } else {
+    desc_set(&desc[head], &r->hdr, sizeof(r->hdr), VRING_DESC_F_NEXT);
+    int prev = head;
+    for (int i = 0; i < nsg; i++) {
+      int d = desc_alloc();
+      desc[prev].next = (uint16_t)d;
+      desc_set(&desc[d], sg[i].addr, sg[i].len, dflags);
+      prev = d;
+    }
+    int st = desc_alloc();
+    desc[prev].next = (uint16_t)st;
+    desc_set(&desc[st], (void *)&r->status, 1, VRING_DESC_F_WRITE);
+  }
 
+  // 2. Put the chain into the avail ring; the notify is left to blk_wait
+  uint16_t aidx = avail->idx;
+  r->seq = aidx;
+  avail->ring[aidx % queue_num] = (uint16_t)head;
   __sync_synchronize();
-  blk_virtq.avail.idx = aidx + 1;
-  __sync_synchronize();
+  avail->idx = aidx + 1;
+  kick_pending = 1;
+  intr_restore(on);
+  return r;
+}
 
-  // 3. Notify device to start processing
-  mmio_write(VIRTIO_MMIO_QUEUE_NOTIFY, 0);
+/* whether blk_wait should poll for r rather than sleep on it right away: a request that
+ * should finish within BLK_SPIN_MAX costs less to catch by spinning than a sleep, a
+ * wakeup and a context switch. The spin ends half an average latency past the expected
+ * completion (so a slow outlier falls back to sleeping), never later than BLK_SPIN_MAX
+ */
+static int blk_spin(struct blk_request *r) {
+  if (r->flags & BLK_WAIT_SLEEP)
+    return 0;
+  uint64_t avg = lat_avg8 / 8;
+  uint64_t now = read_mtime();
+  uint64_t expect = r->submitted + avg;
+  uint64_t end = expect + avg / 2;
+  if (!(r->flags & BLK_WAIT_POLL)) {
+    if (expect > now + BLK_SPIN_MAX)
+      return 0;
+    if (end > now + BLK_SPIN_MAX)
+      end = now + BLK_SPIN_MAX;
+  } else {
+    end = (uint64_t)-1;
+  }
+  while (!r->done && read_mtime() < end)
+    blk_reap();
+  return r->done;
+}
 
-  // 4. Poll used.idx until completion (works for both V1 and V2, independent of interrupts)
-  uint16_t expect = last_used_idx + 1;
-  for (;;) {
+int blk_wait(struct blk_request *r) {
+  if (!r || !r->busy)
+    return -1;
+  int on = intr_save();
+  blk_kick();
+
+  // Past a short spin for requests that are due, sleep until blk_intr finds r in the
+  // used ring, so other processes run during the I/O. Where sleeping is impossible
+  // (boot, the SQPOLL thread) poll the used ring; other requests completing meanwhile
+  // are handed to their waiters either way
+  uint16_t id = (uint16_t)(r - reqs);
+  blk_spin(r);
+  while (!r->done) {
+    blk_reap();
+    if (r->done || !proc_may_sleep())
+      continue;
+    /* ask for the interrupt: a lone sleeper only needs the one at r's own ring index
+     * (devices mostly complete in order, so earlier requests cost no interrupts), with
+     * others sleeping, or r overtaken, the next completion
+     */
+    if (!r->sleeping) {
+      r->sleeping = 1;
+      nsleep++;
+    }
+    intr_want(nsleep == 1 && (int16_t)(r->seq - last_used_idx) >= 0 ? r->seq : last_used_idx);
     __sync_synchronize();
-    if (blk_virtq.used.idx >= expect)
-      break;
+    if (used->idx != last_used_idx)
+      continue; // something completed before the device saw the request: reap it first
+    proc_sleep_on(&req_wq[id], 0);
+    intr_off(); // back on after the sleep
   }
-  last_used_idx = blk_virtq.used.idx;
 
-  if (blk_status != 0) {
-    printk(BLUE "[INFO]: \tblk: io error status=%d" RESET "\n", blk_status);
+  uint8_t status = r->status;
+  r->busy = 0;
+  desc_free_chain(id);
+  intr_restore(on);
+  if (status != 0) {
+    printk(BLUE "[INFO]: \tblk: io error status=%d" RESET "\n", status);
     return -1;
   }
   return 0;
 }
 
+// requests of one blk_read/blk_write/blk_rw_batch call, in flight together (a FIFO)
+struct blk_inflight {
+  struct blk_request *rq[BLK_BATCH_MAX];
+  uint32_t first, last;
+  int err;
+};
+
+// queue one request, first waiting for older ones while the ring or the FIFO is full;
+// -1 if it cannot ever fit (no device, or a queue too small for it)
+static int inflight_submit(struct blk_inflight *q, uint32_t type, uint64_t sector,
+                           const struct blk_sg *sg, int nsg) {
+  for (;;) {
+    struct blk_request *r = NULL;
+    if (q->last - q->first < BLK_BATCH_MAX)
+      r = blk_submit(type, sector, sg, nsg, 0);
+    if (r) {
+      q->rq[q->last++ % BLK_BATCH_MAX] = r;
+      return 0;
+    }
+    if (q->first == q->last)
+      return -1;
+    if (blk_wait(q->rq[q->first++ % BLK_BATCH_MAX]) < 0)
+      q->err = -1;
+  }
+}
+
+static int inflight_drain(struct blk_inflight *q) {
+  while (q->first != q->last)
+    if (blk_wait(q->rq[q->first++ % BLK_BATCH_MAX]) < 0)
+      q->err = -1;
+  return q->err;
+}
+
+static int blk_rw(uint32_t type, uint64_t sector, uint32_t count, const struct blk_sg *sg,
+                  int nsg) {
+  uint64_t bytes = 0;
+  for (int i = 0; i < nsg; i++) {
+    if (sg[i].len % BLK_SECTOR_SIZE)
+      return -1;
+    bytes += sg[i].len;
+  }
+  if (bytes != (uint64_t)count * BLK_SECTOR_SIZE)
+    return -1;
+
+  // cut the list into requests of at most seg_max pieces of at most size_max bytes
+  struct blk_inflight q = {0};
+  struct blk_sg piece[BLK_SEG_MAX];
+  int i = 0;
+  uint32_t ioff = 0; // bytes of sg[i] already taken
+  while (i < nsg) {
+    int np = 0;
+    uint32_t len = 0;
+    while (i < nsg && np < seg_max) {
+      uint32_t c = sg[i].len - ioff;
+      if (c > size_max)
+        c = size_max;
+      piece[np].addr = (char *)sg[i].addr + ioff;
+      piece[np++].len = c;
+      len += c;
+      ioff += c;
+      if (ioff == sg[i].len) {
+        i++;
+        ioff = 0;
+      }
+    }
+    if (np == 0)
+      break; // only empty segments left
+    if (inflight_submit(&q, type, sector, piece, np) < 0) {
+      inflight_drain(&q);
+      return -1;
+    }
+    sector += len / BLK_SECTOR_SIZE;
+  }
+  return inflight_drain(&q);
+}
+
+int blk_read(uint64_t sector, uint32_t count, const struct blk_sg *sg, int nsg) {
+  return blk_rw(VIRTIO_BLK_T_IN, sector, count, sg, nsg);
+}
+
+int blk_write(uint64_t sector, uint32_t count, const struct blk_sg *sg, int nsg) {
+  return blk_rw(VIRTIO_BLK_T_OUT, sector, count, sg, nsg);
+}
+
+int blk_rw_batch(uint32_t type, const uint64_t *sectors, void *const *bufs, int n) {
+  if (n < 0 || n > BLK_BATCH_MAX)
+    return -1;
+  struct blk_inflight q = {0};
+  struct blk_sg run[BLK_BATCH_MAX];
+  int nrun = 0;
+  for (int i = 0; i <= n; i++) {
+    // a run ends at a gap in the sectors or at the device limits
+    if (nrun > 0 && (i == n || sectors[i] != sectors[i - 1] + 1 || nrun == seg_max ||
+                     (uint64_t)(nrun + 1) * BLK_SECTOR_SIZE > size_max)) {
+      if (inflight_submit(&q, type, sectors[i - nrun], run, nrun) < 0) {
+        inflight_drain(&q);
+        return -1;
+      }
+      nrun = 0;
+    }
+    if (i < n) {
+      run[nrun].addr = bufs[i];
+      run[nrun++].len = BLK_SECTOR_SIZE;
+    }
+  }
+  return inflight_drain(&q);
+}
+
 // --- Initialization ---
 
 void blk_init(void) {
@@ -155,13 +488,16 @@ void blk_init(void) {
   uint32_t status = VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER;
   mmio_write(VIRTIO_MMIO_STATUS, status);
 
-  // 3. Feature negotiation: just read and then declare that we do not use optional features
+  // 3. Feature negotiation: take the request size limits if the device has any
   mmio_write(VIRTIO_MMIO_DEVICE_FEATURES_SEL, 0);
   uint32_t host_features = mmio_read(VIRTIO_MMIO_DEVICE_FEATURES);
-  (void)host_features; // currently unused
+  uint32_t features = host_features & ((1u << VIRTIO_BLK_F_SIZE_MAX) |
+                                       (1u << VIRTIO_BLK_F_SEG_MAX) |
+                                       (1u << VIRTIO_RING_F_INDIRECT_DESC) |
+                                       (1u << VIRTIO_RING_F_EVENT_IDX));
 
   mmio_write(VIRTIO_MMIO_DRIVER_FEATURES_SEL, 0);
-  mmio_write(VIRTIO_MMIO_DRIVER_FEATURES, 0); // do not enable any optional features
+  mmio_write(VIRTIO_MMIO_DRIVER_FEATURES, features);
 
   status |= VIRTIO_STATUS_FEATURES_OK;
   mmio_write(VIRTIO_MMIO_STATUS, status);
@@ -181,15 +517,53 @@ void blk_init(void) {
 
   mmio_write(VIRTIO_MMIO_QUEUE_SEL, 0);
   uint32_t qmax = mmio_read(VIRTIO_MMIO_QUEUE_NUM_MAX);
-  if (qmax == 0)
-    return;
-  if (qmax > 8)
-    qmax = 8;
-  mmio_write(VIRTIO_MMIO_QUEUE_NUM, qmax);
+  if (qmax < 4)
+    return; // not even one request chain fits
+  // the largest power of two the device and our ring memory allow
+  uint32_t qnum = BLK_QUEUE_MAX;
+  while (qnum > qmax)
+    qnum >>= 1;
+  queue_num = (uint16_t)qnum;
+  mmio_write(VIRTIO_MMIO_QUEUE_NUM, qnum);
+
+  desc = (struct virtq_desc *)vq_mem;
+  avail = (struct virtq_avail *)(vq_mem + VQ_AVAIL_OFF(qnum));
+  used = (volatile struct virtq_used *)(vq_mem + VQ_USED_OFF(qnum));
+  memset(vq_mem, 0, sizeof(vq_mem));
+  memset(reqs, 0, sizeof(reqs));
+  for (uint32_t i = 0; i < qnum; i++)
+    desc[i].next = (uint16_t)(i + 1);
+  free_head = 0;
+  num_free = (uint16_t)qnum;
+  last_used_idx = 0;
+  kick_pending = 0;
+  kicked_idx = 0;
+  nsleep = 0;
+  event_idx = !!(features & (1u << VIRTIO_RING_F_EVENT_IDX));
+  indirect = !!(features & (1u << VIRTIO_RING_F_INDIRECT_DESC));
+  intr_mute();
+
+  // request limits: ours, the device's if it gave any, and room for a whole chain in
+  // the ring (header and status take a descriptor each)
+  seg_max = BLK_SEG_MAX;
+  if ((int)qnum - 2 < seg_max)
+    seg_max = (int)qnum - 2;
+  if (features & (1u << VIRTIO_BLK_F_SEG_MAX)) {
+    uint32_t dev = mmio_read(VIRTIO_MMIO_CONFIG + VIRTIO_BLK_CFG_SEG_MAX);
+    if (dev >= 1 && dev < (uint32_t)seg_max)
+      seg_max = (int)dev;
+  }
+  size_max = UINT32_MAX - UINT32_MAX % BLK_SECTOR_SIZE;
+  if (features & (1u << VIRTIO_BLK_F_SIZE_MAX)) {
+    uint32_t dev = mmio_read(VIRTIO_MMIO_CONFIG + VIRTIO_BLK_CFG_SIZE_MAX);
+    dev -= dev % BLK_SECTOR_SIZE;
+    if (dev >= BLK_SECTOR_SIZE)
+      size_max = dev;
+  }
 
-  uintptr_t base_pa = V2P(&blk_virtq);
-  uintptr_t avail_pa = V2P(&blk_virtq.avail);
-  uintptr_t used_pa = V2P(&blk_virtq.used);
+  uintptr_t base_pa = V2P(desc);
+  uintptr_t avail_pa = V2P(avail);
+  uintptr_t used_pa = V2P(used);
 
   if (device_version == 1) {
     // V1: PFN setup + Align(4096)
@@ -211,14 +585,16 @@ void blk_init(void) {
   status |= VIRTIO_STATUS_DRIVER_OK;
   mmio_write(VIRTIO_MMIO_STATUS, status);
 
-  last_used_idx = 0;
-  blk_virtq.avail.idx = 0;
-  blk_virtq.used.idx = 0;
-
-  printk(BLUE "[INFO]: \tblk: initialized (ver=%d)" RESET "\n", device_version);
+  printk(BLUE "[INFO]: \tblk: initialized (ver=%d, queue=%d, segs=%d%s%s)" RESET "\n",
+         device_version, queue_num, seg_max, event_idx ? ", event-idx" : "",
+         indirect ? ", indirect" : "");
 }
 
-int blk_read_sector(uint64_t sector, void *buf) { return blk_do_io(VIRTIO_BLK_T_IN, sector, buf); }
+int blk_read_sector(uint64_t sector, void *buf) {
+  struct blk_sg sg = {buf, BLK_SECTOR_SIZE};
+  return blk_read(sector, 1, &sg, 1);
+}
 int blk_write_sector(uint64_t sector, const void *buf) {
-  return blk_do_io(VIRTIO_BLK_T_OUT, sector, (void *)buf);
+  struct blk_sg sg = {(void *)buf, BLK_SECTOR_SIZE};
+  return blk_write(sector, 1, &sg, 1);
 }
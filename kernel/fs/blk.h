@@ -45,6 +45,7 @@
 #define VIRTIO_MMIO_INTERRUPT_STATUS 0x060 // Read only
 #define VIRTIO_MMIO_INTERRUPT_ACK 0x064    // Write only
 #define VIRTIO_MMIO_STATUS 0x070
+#define VIRTIO_MMIO_CONFIG 0x100 // device config space (both versions)
 
 // V2 64-bit queue addresses
 #define VIRTIO_MMIO_QUEUE_DESC_LOW 0x080
@@ -63,11 +64,42 @@
 #define VIRTIO_BLK_T_IN 0
 #define VIRTIO_BLK_T_OUT 1
 
+// virtio-blk feature bits and their config fields (offsets into VIRTIO_MMIO_CONFIG)
+#define VIRTIO_BLK_F_SIZE_MAX 1 // size_max: most bytes in one data descriptor
+#define VIRTIO_BLK_F_SEG_MAX 2  // seg_max: most data descriptors in one request
+#define VIRTIO_BLK_CFG_SIZE_MAX 0x08
+#define VIRTIO_BLK_CFG_SEG_MAX 0x0c
+
 // Bits in desc.flags inside the queue
 #define VRING_DESC_F_NEXT 1
 #define VRING_DESC_F_WRITE 2
-
-// --- Struct definitions (with padding) ---
+#define VRING_DESC_F_INDIRECT 4 // addr/len is a table of descriptors holding the chain
+// avail.flags / used.flags (hints, when EVENT_IDX is not negotiated)
+#define VRING_AVAIL_F_NO_INTERRUPT 1
+#define VRING_USED_F_NO_NOTIFY 1
+
+// ring feature bits, common to all device types
+#define VIRTIO_RING_F_INDIRECT_DESC 28
+#define VIRTIO_RING_F_EVENT_IDX 29 // used_event / avail_event fields past the rings
+
+#define BLK_SECTOR_SIZE 512
+
+// largest queue we set up (the device may offer more, QUEUE_NUM_MAX); a power of two
+#define BLK_QUEUE_MAX 256
+// most sectors blk_rw_batch() takes at once, most requests blk_read/blk_write keep in flight
+#define BLK_BATCH_MAX 16
+// most data segments in one request (lowered to the device's seg_max)
+#define BLK_SEG_MAX 32
+
+// blk_submit flags: how blk_wait waits for this request. By default it spins while the
+// request should be about to finish (going by recent latency) and sleeps otherwise
+#define BLK_WAIT_POLL 0x1  // always spin on the used ring (short, latency-critical I/O)
+#define BLK_WAIT_SLEEP 0x2 // never spin, sleep until the interrupt
+
+// --- Struct definitions ---
+// The rings are sized at init from QUEUE_NUM_MAX, so they end in flexible arrays and
+// live in one page-aligned block: descriptors, avail ring, then (at the next 4096
+// boundary, as the V1 PFN layout requires) the used ring.
 
 struct virtq_desc {
   uint64_t addr;
@@ -79,18 +111,18 @@ struct virtq_desc {
 struct virtq_avail {
   uint16_t flags;
   uint16_t idx;
-  uint16_t ring[8];
+  uint16_t ring[];
 };
 
 struct virtq_used_elem {
-  uint32_t id;
+  uint32_t id; // head descriptor of the completed chain
   uint32_t len;
 };
 
 struct virtq_used {
   uint16_t flags;
   uint16_t idx;
-  struct virtq_used_elem ring[8];
+  struct virtq_used_elem ring[];
 };
 
 struct virtio_blk_req {
@@ -99,29 +131,56 @@ struct virtio_blk_req {
   uint64_t sector;
 };
 
-// Key: force padding to satisfy V1 PFN page alignment requirements
-struct virtq {
-  struct virtq_desc desc[8]; // 128 bytes
-  struct virtq_avail avail;  // 20 bytes
-  // Padding: make 'used' start at offset 4096
-  uint8_t pad[4096 - sizeof(struct virtq_desc) * 8 - sizeof(struct virtq_avail)];
-  struct virtq_used used; // aligned to 4096
-} __attribute__((aligned(4096)));
-
-// --- Global state ---
-
-static volatile uint32_t *mmio = NULL;
-// virtio-mmio version: 1 (legacy) or 2 (modern)
-static uint32_t device_version = 0;
-static struct virtq blk_virtq;
-static struct virtio_blk_req blk_req;
-static volatile uint8_t blk_status;
+// one request in flight, indexed by its head descriptor: header and status byte are
+// per request, so any number of them can be queued at once
+struct blk_request {
+  struct virtio_blk_req hdr;
+  volatile uint8_t status; // written by the device
+  volatile uint8_t done;   // its chain showed up in the used ring
+  uint8_t busy;            // submitted and not yet collected by blk_wait
+  uint8_t flags;           // BLK_WAIT_*
+  uint8_t sleeping;        // its waiter sleeps for the interrupt
+  uint16_t seq;            // avail ring index it went in at
+  uint64_t submitted;      // mtime at blk_submit
+};
 
-// Currently we submit only one request at a time, so we just track used.idx
-static volatile uint16_t last_used_idx = 0;
+// one piece of a scatter-gather list; len is a multiple of BLK_SECTOR_SIZE
+struct blk_sg {
+  void *addr;
+  uint32_t len;
+};
 
 void blk_init(void);
+/* queue one transfer (VIRTIO_BLK_T_IN/OUT) of the sectors from sector on, to or from
+ * the nsg segments in order, without waiting for it. The segments must respect the
+ * device limits (at most blk_seg_max() of them, blk_size_max() bytes each; blk_read and
+ * blk_write split for you). The device is notified on the next blk_wait (so a batch
+ * costs one notify). flags are BLK_WAIT_*. Returns NULL if the ring has too few free
+ * descriptors: wait for an earlier request and retry
+ */
+struct blk_request *blk_submit(uint32_t type, uint64_t sector, const struct blk_sg *sg, int nsg,
+                               int flags);
+/* wait for r to complete and release it; 0 on success, -1 on an I/O error. Spins for
+ * a bounded time if r is expected to finish soon, then sleeps (if the caller can, see
+ * proc_may_sleep) until the interrupt
+ */
+int blk_wait(struct blk_request *r);
+// device limits for one request, as negotiated at init
+int blk_seg_max(void);
+uint32_t blk_size_max(void);
+/* count sectors from sector on, scattered over / gathered from the segments (their
+ * lengths add up to count sectors): as few requests as the device limits allow, all in
+ * flight together. 0 on success, -1 on an I/O error
+ */
+int blk_read(uint64_t sector, uint32_t count, const struct blk_sg *sg, int nsg);
+int blk_write(uint64_t sector, uint32_t count, const struct blk_sg *sg, int nsg);
+/* n single-sector transfers (n <= BLK_BATCH_MAX) kept in flight together; runs of
+ * consecutive sectors go out as one request each. -1 if any failed
+ */
+int blk_rw_batch(uint32_t type, const uint64_t *sectors, void *const *bufs, int n);
 int blk_read_sector(uint64_t sector, void *buf);
 int blk_write_sector(uint64_t sector, const void *buf);
+// PLIC interrupt of the device: collect completions; returns how many waiters were woken
+int blk_intr(void);
 
 #endif
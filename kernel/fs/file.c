@@ -0,0 +1,296 @@
+/*
+ * Lrix
+ * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+ *
+ * This program is released under the terms of the GNU General Public License version 2(GPLv2).
+ * See https://opensource.org/licenses/GPL-2.0 for more information.
+ *
+ * Project homepage: https://github.com/lrisguan/Lrix
+ * Description: A scratch implemention of OS based on RISC-V
+ */
+
+// file.c - open file table, console file and per-process fd tables
+//
+// Callers run with interrupts off (syscalls, fork, exit, the SQPOLL thread) and no table
+// update sleeps, so the tables need no further locking. The file ops may: pipe and
+// console reads/writes and disk I/O (the filesystem has its own lock, see fs.c).
+
+#include "file.h"
+#include "../include/log.h"
+#include "../include/riscv.h"
+#include "../proc/proc.h"
+#include "../string/string.h"
+#include "../uart/uart.h"
+#include "poll.h"
+
+static struct file files[NFILE];
+
+struct file *file_alloc(int type, const struct file_ops *ops) {
+  for (int i = 0; i < NFILE; i++) {
+    struct file *f = &files[i];
+    if (f->type != FILE_NONE)
+      continue;
+    memset(f, 0, sizeof(*f));
+    f->type = type;
+    f->ref = 1;
+    f->ops = ops;
+    return f;
+  }
+  return NULL;
+}
+
+struct file *file_dup(struct file *f) {
+  if (f)
+    f->ref++;
+  return f;
+}
+
+void file_close(struct file *f) {
+  if (!f || f->ref <= 0)
+    return;
+  if (--f->ref > 0)
+    return;
+  if (f->ops->release)
+    f->ops->release(f);
+  f->type = FILE_NONE;
+}
+
+static int iov_ok(const struct iovec *iov, int iovcnt) {
+  if (!iov || iovcnt < 0 || iovcnt > FS_IOV_MAX)
+    return 0;
+  for (int i = 0; i < iovcnt; i++)
+    if (!iov[i].iov_base && iov[i].iov_len)
+      return 0;
+  return 1;
+}
+
+int64_t file_read(struct file *f, const struct iovec *iov, int iovcnt, int64_t off) {
+  if (!f || !f->ops->read || !iov_ok(iov, iovcnt))
+    return -1;
+  return f->ops->read(f, iov, iovcnt, off);
+}
+
+int64_t file_write(struct file *f, const struct iovec *iov, int iovcnt, int64_t off) {
+  if (!f || !f->ops->write || !iov_ok(iov, iovcnt))
+    return -1;
+  return f->ops->write(f, iov, iovcnt, off);
+}
+
+int64_t file_lseek(struct file *f, int64_t off, int whence) {
+  if (!f || !f->ops->lseek)
+    return -1;
+  return f->ops->lseek(f, off, whence);
+}
+
+int64_t file_copy(struct file *in, struct file *out, uint64_t len) {
+  if (!in || !out || !in->ops->read || !out->ops->write)
+    return -1;
+  if (in->type == FILE_INODE && out->type == FILE_INODE)
+    return fs_copy_range(in, &in->offset, out, &out->offset, len);
+
+  // anything else bounces through one kernel block instead of a user buffer
+  char buf[BSIZE];
+  int64_t tot = 0;
+  while ((uint64_t)tot < len) {
+    struct iovec v = {buf, len - (uint64_t)tot < BSIZE ? len - (uint64_t)tot : BSIZE};
+    int64_t r = in->ops->read(in, &v, 1, -1);
+    if (r <= 0) {
+      if (r < 0 && tot == 0)
+        return -1;
+      break;
+    }
+    v.iov_len = (uint64_t)r;
+    int64_t w = out->ops->write(out, &v, 1, -1);
+    if (w < 0)
+      return tot ? tot : -1;
+    tot += w;
+    if (w < r)
+      break;
+  }
+  return tot;
+}
+
+int file_stat(struct file *f, struct stat *st) {
+  if (!f || !st)
+    return -1;
+  if (f->type == FILE_INODE)
+    return fs_stat_inode(f->inum, st);
+  // files that are not on disk only have a type
+  memset(st, 0, sizeof(*st));
+  st->type = f->type == FILE_CONSOLE ? T_DEV : f->type == FILE_PIPE ? T_PIPE : T_EPOLL;
+  st->nlink = 1;
+  return 0;
+}
+
+// ---- console ----
+
+#define CONSOLE_EOF 0x04 // ^D
+
+/* raw console input: sleep for the first character, then take whatever else the UART
+ * has buffered. Carriage returns become newlines and ^D is end of file.
+ */
+static int64_t console_read(struct file *f, const struct iovec *iov, int iovcnt, int64_t off) {
+  (void)f;
+  if (off >= 0)
+    return -1;
+  int64_t tot = 0;
+  for (int i = 0; i < iovcnt; i++) {
+    char *dst = (char *)iov[i].iov_base;
+    for (uint64_t j = 0; j < iov[i].iov_len; j++) {
+      char c = tot == 0 ? uart_getc_sleep() : uart_getc();
+      if (c == 0 || c == CONSOLE_EOF) // nothing more buffered / end of file
+        return tot;
+      dst[j] = c == '\r' ? '\n' : c;
+      tot++;
+    }
+  }
+  return tot;
+}
+
+static int64_t console_write(struct file *f, const struct iovec *iov, int iovcnt, int64_t off) {
+  (void)f;
+  if (off >= 0)
+    return -1;
+  int64_t tot = 0;
+  for (int i = 0; i < iovcnt; i++) {
+    const char *s = (const char *)iov[i].iov_base;
+    for (uint64_t j = 0; j < iov[i].iov_len; j++)
+      printk("%c", s[j]);
+    tot += (int64_t)iov[i].iov_len;
+  }
+  return tot;
+}
+
+static uint32_t console_poll(struct file *f, struct poll_table *pt) {
+  (void)f;
+  return (uart_poll(pt) ? POLLIN : 0) | POLLOUT;
+}
+
+static const struct file_ops console_ops = {
+    .read = console_read,
+    .write = console_write,
+    .lseek = NULL,
+    .poll = console_poll,
+    .release = NULL,
+};
+
+// shared by every process's 0/1/2; its first reference is never dropped
+static struct file *console_file;
+
+static struct file *console_get(void) {
+  if (!console_file)
+    console_file = file_alloc(FILE_CONSOLE, &console_ops);
+  return file_dup(console_file);
+}
+
+// ---- per-process fd tables ----
+
+static PCB *fd_owner(PCB *p) { return proc_group_leader(p); }
+
+int fd_install(PCB *p, struct file *f, int flags) {
+  p = fd_owner(p);
+  if (!p || !f)
+    return -1;
+  for (int fd = 0; fd < NOFILE; fd++) {
+    if (p->ofile[fd])
+      continue;
+    p->ofile[fd] = f;
+    p->fd_flags[fd] = (uint8_t)(flags & FD_CLOEXEC);
+    return fd;
+  }
+  return -1;
+}
+
+struct file *fd_get(PCB *p, int fd) {
+  p = fd_owner(p);
+  if (!p || fd < 0 || fd >= NOFILE)
+    return NULL;
+  return p->ofile[fd];
+}
+
+struct file *fget(PCB *p, int fd) { return file_dup(fd_get(p, fd)); }
+
+int fd_close(PCB *p, int fd) {
+  struct file *f = fd_get(p, fd);
+  if (!f)
+    return -1;
+  p = fd_owner(p);
+  p->ofile[fd] = NULL;
+  p->fd_flags[fd] = 0;
+  file_close(f);
+  return 0;
+}
+
+int fd_dup(PCB *p, int fd) {
+  struct file *f = fd_get(p, fd);
+  if (!f)
+    return -1;
+  int nfd = fd_install(p, file_dup(f), 0);
+  if (nfd < 0)
+    file_close(f);
+  return nfd;
+}
+
+int fd_dup2(PCB *p, int fd, int newfd) {
+  struct file *f = fd_get(p, fd);
+  if (!f || newfd < 0 || newfd >= NOFILE)
+    return -1;
+  if (newfd == fd)
+    return newfd;
+  p = fd_owner(p);
+  struct file *old = p->ofile[newfd];
+  p->ofile[newfd] = file_dup(f);
+  p->fd_flags[newfd] = 0;
+  file_close(old);
+  return newfd;
+}
+
+int fd_fcntl(PCB *p, int fd, int cmd, uint64_t arg) {
+  if (!fd_get(p, fd))
+    return -1;
+  p = fd_owner(p);
+  if (cmd == F_GETFD)
+    return p->fd_flags[fd];
+  if (cmd == F_SETFD) {
+    p->fd_flags[fd] = (uint8_t)(arg & FD_CLOEXEC);
+    return 0;
+  }
+  return -1;
+}
+
+void fd_init_console(PCB *p) {
+  for (int fd = 0; fd < 3; fd++) {
+    fd_close(p, fd);
+    p->ofile[fd] = console_get();
+  }
+}
+
+void fd_copy(PCB *child, PCB *parent, int spawn) {
+  parent = fd_owner(parent);
+  if (!parent)
+    return;
+  fd_release_all(child);
+  for (int fd = 0; fd < NOFILE; fd++) {
+    if (!parent->ofile[fd] || (spawn && (parent->fd_flags[fd] & FD_CLOEXEC)))
+      continue;
+    child->ofile[fd] = file_dup(parent->ofile[fd]);
+    child->fd_flags[fd] = parent->fd_flags[fd];
+  }
+}
+
+void fd_close_on_exec(PCB *p) {
+  PCB *owner = fd_owner(p);
+  if (!owner)
+    return;
+  for (int fd = 0; fd < NOFILE; fd++)
+    if (owner->ofile[fd] && (owner->fd_flags[fd] & FD_CLOEXEC))
+      fd_close(owner, fd);
+}
+
+void fd_release_all(PCB *p) {
+  for (int fd = 0; fd < NOFILE; fd++) {
+    file_close(p->ofile[fd]);
+    p->ofile[fd] = NULL;
+    p->fd_flags[fd] = 0;
+  }
+}
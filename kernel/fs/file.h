@@ -0,0 +1,108 @@
+/*
+ * Lrix
+ * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+ *
+ * This program is released under the terms of the GNU General Public License version 2(GPLv2).
+ * See https://opensource.org/licenses/GPL-2.0 for more information.
+ *
+ * Project homepage: https://github.com/lrisguan/Lrix
+ * Description: A scratch implemention of OS based on RISC-V
+ */
+
+// file.h - open files and per-process file descriptor tables
+//
+// An fd is an index into its process's table (threads use their group leader's), whose
+// slot points at a refcounted open file. open() creates a new open file; dup, fork and
+// spawn share it, offset included. Console, inode and pipe files all go through the
+// same file_ops, so callers never care what is behind an fd.
+
+#ifndef _FILE_H_
+#define _FILE_H_
+
+#include "fs.h"
+#include <stdint.h>
+
+#define NFILE 64  // open files in the whole system
+#define NOFILE 16 // fds per process; 0/1/2 start out on the console
+
+// open() flags
+#define O_CREATE 0x1  // create the file, fail if it exists
+#define O_CLOEXEC 0x2 // the new fd gets FD_CLOEXEC
+
+// fcntl() commands and fd flags
+#define F_GETFD 1
+#define F_SETFD 2
+#define FD_CLOEXEC 0x1 // closed by exec, not inherited by spawned programs (fork keeps it)
+
+enum file_type { FILE_NONE = 0, FILE_CONSOLE, FILE_INODE, FILE_PIPE, FILE_EPOLL };
+
+struct file;
+struct pipe;
+struct epoll;
+struct poll_table;
+
+struct file_ops {
+  // off < 0 transfers at the file offset and advances it, off >= 0 is positional (-1 on
+  // files that cannot seek); return bytes transferred or -1
+  int64_t (*read)(struct file *f, const struct iovec *iov, int iovcnt, int64_t off);
+  int64_t (*write)(struct file *f, const struct iovec *iov, int iovcnt, int64_t off);
+  int64_t (*lseek)(struct file *f, int64_t off, int whence); // NULL: not seekable
+  // POLL* readiness now; with pt, also hand it the queues woken on a change (poll.h).
+  // NULL: always readable and writable
+  uint32_t (*poll)(struct file *f, struct poll_table *pt);
+  void (*release)(struct file *f); // last reference is gone
+};
+
+struct file {
+  int type; // FILE_*, FILE_NONE = free slot
+  int ref;  // fd slots (of any process) and epoll sets pointing here
+  const struct file_ops *ops;
+  uint32_t inum;     // FILE_INODE: inode number on disk
+  uint32_t offset;   // FILE_INODE: read/write offset
+  struct pipe *pipe; // FILE_PIPE: the pipe this is one end of
+  struct epoll *ep;  // FILE_EPOLL: the interest set
+};
+
+// a new open file with one reference, or NULL if all NFILE are in use
+struct file *file_alloc(int type, const struct file_ops *ops);
+struct file *file_dup(struct file *f);
+// drop one reference; the last one releases the file
+void file_close(struct file *f);
+int64_t file_read(struct file *f, const struct iovec *iov, int iovcnt, int64_t off);
+int64_t file_write(struct file *f, const struct iovec *iov, int iovcnt, int64_t off);
+int64_t file_lseek(struct file *f, int64_t off, int whence);
+/* move up to len bytes from in to out at their file offsets inside the kernel: disk to
+ * disk block by block (fs_copy_range), anything else through one kernel block buffer
+ * until len bytes, end of file or a short write. Returns bytes moved or -1
+ */
+int64_t file_copy(struct file *in, struct file *out, uint64_t len);
+
+// metadata of an open file: the inode's for disk files, just a T_* type otherwise
+int file_stat(struct file *f, struct stat *st);
+
+struct ProcessControlBlock;
+
+// put f at p's lowest free fd with fd flags FD_*; the slot takes over the caller's
+// reference. Returns the fd, or -1 if the table is full (the reference stays with the caller)
+int fd_install(struct ProcessControlBlock *p, struct file *f, int flags);
+// open file behind fd, NULL if fd is not open
+struct file *fd_get(struct ProcessControlBlock *p, int fd);
+// fd_get with a reference of the caller's, dropped with file_close: for operations that
+// may sleep, while another thread of the group can close fd
+struct file *fget(struct ProcessControlBlock *p, int fd);
+int fd_close(struct ProcessControlBlock *p, int fd);
+// share fd's open file at the lowest free fd / at newfd (closing what was there);
+// the copy never has FD_CLOEXEC. Return the new fd or -1
+int fd_dup(struct ProcessControlBlock *p, int fd);
+int fd_dup2(struct ProcessControlBlock *p, int fd, int newfd);
+int fd_fcntl(struct ProcessControlBlock *p, int fd, int cmd, uint64_t arg);
+// a new process: 0/1/2 on the console
+void fd_init_console(struct ProcessControlBlock *p);
+// give child a copy of parent's table (fork), without the FD_CLOEXEC fds for spawn
+void fd_copy(struct ProcessControlBlock *child, struct ProcessControlBlock *parent, int spawn);
+// close every fd of p (exit/reap)
+void fd_release_all(struct ProcessControlBlock *p);
+// close p's FD_CLOEXEC fds (exec)
+void fd_close_on_exec(struct ProcessControlBlock *p);
+
+#endif /* _FILE_H_ */
@@ -13,8 +13,48 @@
 
 #include "fs.h"
 #include "../include/log.h"
+#include "../include/riscv.h"
+#include "../proc/proc.h"
 #include "../string/string.h"
 #include "blk.h"
+#include "file.h"
+
+static struct superblock sb;
+
+/* Disk I/O sleeps (blk_wait), so another process may enter the filesystem while one is
+ * in the middle of an update. Every entry point below holds this sleeping lock; the
+ * *_locked helpers expect it held.
+ */
+static struct {
+  int busy;
+  int intr; // holder's interrupt state before fs_lock
+  waitqueue wq;
+} fs_mutex;
+
+static void fs_lock(void) {
+  int on = intr_save();
+  proc_io_begin(); // waiting for the lock already counts: see proc_kill
+  while (fs_mutex.busy) {
+    if (proc_may_sleep()) {
+      proc_sleep_on(&fs_mutex.wq, 0);
+      intr_off();
+    } else {
+      // cannot sleep (SQPOLL thread): let a timer tick run the holder meanwhile
+      intr_on();
+      intr_off();
+    }
+  }
+  fs_mutex.busy = 1;
+  fs_mutex.intr = on;
+}
+
+static void fs_unlock(void) {
+  int on = fs_mutex.intr;
+  fs_mutex.busy = 0;
+  proc_wakeup(&fs_mutex.wq, 1);
+  proc_io_end();
+  intr_restore(on);
+}
 
 static int b_read(uint32_t blockno, void *buf) {
   if (blockno >= N_BLOCKS)
@@ -42,6 +82,18 @@ static int b_write(uint32_t blockno, const void *buf) {
   return r;
 }
 
+// n blocks in flight at once (n <= BLK_BATCH_MAX), e.g. a run of whole blocks of a read;
+// blocks that are consecutive on disk share one request
+static int b_rw_batch(uint32_t type, const uint64_t *blocknos, void *const *bufs, int n) {
+  for (int i = 0; i < n; i++)
+    if (blocknos[i] >= N_BLOCKS)
+      return -1;
+#ifdef FS_DEBUG
+  printk(BLUE "[INFO]: \tfs: batch of %d blocks from %lu" RESET "\n", n, blocknos[0]);
+#endif
+  return blk_rw_batch(type, blocknos, bufs, n);
+}
+
 // free a previously allocated data block in bitmap
 static int b_free(uint32_t blockno) {
   if (blockno < DATA_START_BLOCK || blockno >= N_BLOCKS)
@@ -70,32 +122,65 @@ static int namecmp(const char *a, const char *b) {
   return 0;
 }
 
+// in-core copies of the on-disk inodes: the table is small enough to keep every inode,
+// loaded on first use and written through, so lookups cost no disk reads
+struct icache_entry {
+  int valid;
+  int nblocks; // data + indirect blocks, -1 = not counted yet
+  uint32_t gen; // bumped on every inode update (fs_inode_gen)
+  struct dinode din;
+};
+static struct icache_entry icache[NINODE];
+
+// move one on-disk inode from/to the inode blocks; an inode may straddle two blocks
+static int dinode_io(uint32_t inum, struct dinode *dip, int write) {
+  uint32_t pos = (inum - 1) * sizeof(struct dinode);
+  uint32_t done = 0;
+  char buf[BSIZE];
+  while (done < sizeof(struct dinode)) {
+    uint32_t block = INODE_START_BLOCK + (pos + done) / BSIZE;
+    uint32_t off = (pos + done) % BSIZE;
+    uint32_t m = BSIZE - off;
+    if (m > sizeof(struct dinode) - done)
+      m = sizeof(struct dinode) - done;
+    if (b_read(block, buf) < 0)
+      return -1;
+    if (write) {
+      memcpy(buf + off, (char *)dip + done, m);
+      if (b_write(block, buf) < 0)
+        return -1;
+    } else {
+      memcpy((char *)dip + done, buf + off, m);
+    }
+    done += m;
+  }
+  return 0;
+}
+
 static int read_dinode(uint32_t inum, struct dinode *dip) {
   if (inum == 0 || inum >= NINODE)
     return -1;
-  uint32_t idx = inum - 1;
-  uint32_t block = INODE_START_BLOCK + (idx * sizeof(struct dinode)) / BSIZE;
-  uint32_t off = (idx * sizeof(struct dinode)) % BSIZE;
-  char buf[BSIZE];
-  if (b_read(block, buf) < 0)
-    return -1;
-  memcpy(dip, buf + off, sizeof(struct dinode));
+  struct icache_entry *ic = &icache[inum];
+  if (!ic->valid) {
+    if (dinode_io(inum, &ic->din, 0) < 0)
+      return -1;
+    ic->valid = 1;
+    ic->nblocks = -1;
+  }
+  memcpy(dip, &ic->din, sizeof(struct dinode));
   return 0;
 }
 
 static int write_dinode(uint32_t inum, const struct dinode *dip) {
   if (inum == 0 || inum >= NINODE)
     return -1;
-  uint32_t idx = inum - 1;
-  uint32_t block = INODE_START_BLOCK + (idx * sizeof(struct dinode)) / BSIZE;
-  uint32_t off = (idx * sizeof(struct dinode)) % BSIZE;
-  char buf[BSIZE];
-  if (b_read(block, buf) < 0)
-    return -1;
-  memcpy(buf + off, dip, sizeof(struct dinode));
-  if (b_write(block, buf) < 0)
-    return -1;
-  return 0;
+  struct icache_entry *ic = &icache[inum];
+  // the cache stays right even if the disk write fails: on-disk state is then stale
+  memcpy(&ic->din, dip, sizeof(struct dinode));
+  ic->valid = 1;
+  ic->nblocks = -1;
+  ic->gen++;
+  return dinode_io(inum, (struct dinode *)dip, 1);
 }
 
 static int balloc(uint32_t *out_blockno) {
@@ -165,64 +250,180 @@ static uint32_t bmap(struct dinode *dip, uint32_t file_block_idx, int alloc) {
   return bno;
 }
 
-static int inode_read(uint32_t inum, void *dst, uint32_t off, uint32_t n) {
+// total length of an iovec array, clamped to the largest possible file
+static uint32_t iov_total(const struct iovec *iov, int iovcnt) {
+  uint64_t n = 0;
+  for (int i = 0; i < iovcnt; i++)
+    n += iov[i].iov_len;
+  return n > (uint64_t)MAXFILE * BSIZE ? (uint32_t)(MAXFILE * BSIZE) : (uint32_t)n;
+}
+
+// advance the iovec position (*seg, *segoff) by m bytes
+static void iov_advance(const struct iovec *iov, int *seg, uint64_t *segoff, uint32_t m) {
+  while (m > 0) {
+    uint64_t c = iov[*seg].iov_len - *segoff;
+    if (c > m)
+      c = m;
+    m -= (uint32_t)c;
+    *segoff += c;
+    if (*segoff == iov[*seg].iov_len) {
+      (*seg)++;
+      *segoff = 0;
+    }
+  }
+}
+
+// move m bytes between blk and the iovec position (*seg, *segoff), advancing it
+static void iov_xfer(const struct iovec *iov, int *seg, uint64_t *segoff, char *blk, uint32_t m,
+                     int to_iov) {
+  while (m > 0) {
+    const struct iovec *v = &iov[*seg];
+    uint64_t c = v->iov_len - *segoff;
+    if (c > m)
+      c = m;
+    if (to_iov)
+      memcpy((char *)v->iov_base + *segoff, blk, c);
+    else
+      memcpy(blk, (const char *)v->iov_base + *segoff, c);
+    blk += c;
+    m -= (uint32_t)c;
+    *segoff += c;
+    if (*segoff == v->iov_len) {
+      (*seg)++;
+      *segoff = 0;
+    }
+  }
+}
+
+/* read file bytes [off, off + total) into the segments: every block is read once,
+ * however the segments split it; holes read as zeros. Whole blocks that fall inside one
+ * segment are read straight into it, up to BLK_BATCH_MAX blocks in flight together (one
+ * request per run of consecutive disk blocks); the rest goes through a block buffer
+ */
+static int inode_readv(uint32_t inum, const struct iovec *iov, int iovcnt, uint32_t off) {
   struct dinode din;
   if (read_dinode(inum, &din) < 0)
     return -1;
+  uint32_t n = iov_total(iov, iovcnt);
   if (off >= din.size)
     return 0;
-  if (off + n > din.size)
+  if (n > din.size - off)
     n = din.size - off;
 
   uint32_t tot = 0;
+  int seg = 0;
+  uint64_t segoff = 0;
   char buf[BSIZE];
+  uint64_t bnos[BLK_BATCH_MAX];
+  void *dsts[BLK_BATCH_MAX];
+  int nb = 0;
+  uint32_t batch_start = 0; // tot when the pending batch began
   while (tot < n) {
     uint32_t fblk = (off + tot) / BSIZE;
     uint32_t boff = (off + tot) % BSIZE;
-    uint32_t bno = bmap(&din, fblk, 0);
-    if (bno == 0)
-      break;
-    if (b_read(bno, buf) < 0)
-      return -1;
     uint32_t remain_block = BSIZE - boff;
     uint32_t remain_req = n - tot;
     uint32_t m = remain_block < remain_req ? remain_block : remain_req;
-    memcpy((char *)dst + tot, buf + boff, m);
+    uint32_t bno = bmap(&din, fblk, 0);
+    if (bno != 0 && m == BSIZE && iov[seg].iov_len - segoff >= BSIZE) {
+      if (nb == 0)
+        batch_start = tot;
+      bnos[nb] = bno;
+      dsts[nb] = (char *)iov[seg].iov_base + segoff;
+      nb++;
+      iov_advance(iov, &seg, &segoff, BSIZE);
+      tot += BSIZE;
+      if (nb == BLK_BATCH_MAX || tot == n) {
+        if (b_rw_batch(VIRTIO_BLK_T_IN, bnos, dsts, nb) < 0)
+          return batch_start ? (int)batch_start : -1;
+        nb = 0;
+      }
+      continue;
+    }
+    if (nb > 0) {
+      if (b_rw_batch(VIRTIO_BLK_T_IN, bnos, dsts, nb) < 0)
+        return batch_start ? (int)batch_start : -1;
+      nb = 0;
+    }
+    if (bno == 0)
+      memset(buf + boff, 0, m);
+    else if (b_read(bno, buf) < 0)
+      return tot ? (int)tot : -1;
+    iov_xfer(iov, &seg, &segoff, buf + boff, m, 1);
     tot += m;
   }
   return (int)tot;
 }
 
-static int inode_write(uint32_t inum, const void *src, uint32_t off, uint32_t n) {
+/* a block keeps whatever the disk had there past the file size (balloc does not clear
+ * it); zero the bytes of file block fblk from the old size up to boff, which a write at
+ * boff makes part of the file
+ */
+static void zero_gap(char *buf, uint32_t fblk, uint32_t size, uint32_t boff) {
+  uint32_t start = fblk * BSIZE;
+  uint32_t from = size > start ? size - start : 0;
+  if (from < boff)
+    memset(buf + from, 0, boff - from);
+}
+
+/* write the segments to file bytes [off, off + total): every block is written once and
+ * only read first when the write covers part of an existing block. Bytes skipped
+ * between the old end of file and off read back as zeros
+ */
+static int inode_writev(uint32_t inum, const struct iovec *iov, int iovcnt, uint32_t off) {
   struct dinode din;
   if (read_dinode(inum, &din) < 0)
     return -1;
+  uint32_t n = iov_total(iov, iovcnt);
+  uint32_t size = din.size; // before this write
 
   uint32_t tot = 0;
+  int seg = 0;
+  uint64_t segoff = 0;
   char buf[BSIZE];
-  while (tot < (uint32_t)n) {
+  while (tot < n) {
     uint32_t fblk = (off + tot) / BSIZE;
     uint32_t boff = (off + tot) % BSIZE;
+    int fresh = bmap(&din, fblk, 0) == 0;
     uint32_t bno = bmap(&din, fblk, 1);
     if (bno == 0)
-      return -1;
-    if (b_read(bno, buf) < 0)
-      return -1;
+      break;
     uint32_t remain_block = BSIZE - boff;
-    uint32_t remain_req = (uint32_t)n - tot;
+    uint32_t remain_req = n - tot;
     uint32_t m = remain_block < remain_req ? remain_block : remain_req;
-    memcpy(buf + boff, (const char *)src + tot, m);
+    if (m < BSIZE) {
+      if (fresh)
+        memset(buf, 0, BSIZE);
+      else if (b_read(bno, buf) < 0)
+        break;
+      else
+        zero_gap(buf, fblk, size, boff);
+    }
+    iov_xfer(iov, &seg, &segoff, buf + boff, m, 0);
     if (b_write(bno, buf) < 0)
-      return -1;
+      break;
     tot += m;
   }
+  // bmap may have added blocks to din even if a later step failed
   if (off + tot > din.size)
     din.size = off + tot;
   if (write_dinode(inum, &din) < 0)
     return -1;
+  if (tot == 0 && n > 0)
+    return -1;
   return (int)tot;
 }
 
+static int inode_read(uint32_t inum, void *dst, uint32_t off, uint32_t n) {
+  struct iovec v = {dst, n};
+  return inode_readv(inum, &v, 1, off);
+}
+
+static int inode_write(uint32_t inum, const void *src, uint32_t off, uint32_t n) {
+  struct iovec v = {(void *)src, n};
+  return inode_writev(inum, &v, 1, off);
+}
+
 static int ialloc(uint16_t type, uint32_t *out_inum) {
   struct dinode din;
   for (uint32_t inum = 1; inum < NINODE; inum++) {
@@ -242,7 +443,8 @@ static int ialloc(uint16_t type, uint32_t *out_inum) {
   return -1;
 }
 
-static int dir_lookup(const char *name, uint32_t *out_inum) {
+// find name in the root directory: its inode number and the offset of its dirent
+static int dir_find(const char *name, uint32_t *out_inum, uint32_t *out_off) {
   uint32_t inum = sb.root_inum;
   struct dinode din;
   if (read_dinode(inum, &din) < 0)
@@ -255,6 +457,8 @@ static int dir_lookup(const char *name, uint32_t *out_inum) {
       return -1;
     if (de.inum != 0 && namecmp(de.name, name) == 0) {
       *out_inum = de.inum;
+      if (out_off)
+        *out_off = off;
       return 0;
     }
     off += sizeof(de);
@@ -262,6 +466,20 @@ static int dir_lookup(const char *name, uint32_t *out_inum) {
   return -1;
 }
 
+static int dir_lookup(const char *name, uint32_t *out_inum) {
+  return dir_find(name, out_inum, NULL);
+}
+
+// copy name into a dirent name field (truncated to FS_NAME_MAX - 1 characters)
+static void dirent_set_name(struct dirent *de, const char *name) {
+  int i = 0;
+  while (i < FS_NAME_MAX - 1 && name[i]) {
+    de->name[i] = name[i];
+    i++;
+  }
+  de->name[i] = '\0';
+}
+
 static int dir_add(const char *name, uint32_t inum) {
   uint32_t root = sb.root_inum;
   struct dinode din;
@@ -270,12 +488,7 @@ static int dir_add(const char *name, uint32_t inum) {
   struct dirent de;
   memset(&de, 0, sizeof(de));
   de.inum = inum;
-  int i = 0;
-  while (i < FS_NAME_MAX - 1 && name[i]) {
-    de.name[i] = name[i];
-    i++;
-  }
-  de.name[i] = '\0';
+  dirent_set_name(&de, name);
   if (inode_write(root, &de, din.size, sizeof(de)) != (int)sizeof(de))
     return -1;
   return 0;
@@ -313,11 +526,16 @@ static void fs_format(void) {
 
   INFO("fs: formatting disk image");
 
-  // zero inode blocks and bitmap
+  // zero inode blocks and bitmap, which follow each other on disk: one request
+  uint64_t bnos[INODE_BLOCKS + 1];
+  void *bufs[INODE_BLOCKS + 1];
   memset(buf, 0, BSIZE);
-  for (uint32_t b = INODE_START_BLOCK; b < INODE_START_BLOCK + INODE_BLOCKS; b++)
-    b_write(b, buf);
-  b_write(BITMAP_BLOCK, buf);
+  for (uint32_t i = 0; i <= INODE_BLOCKS; i++) {
+    bnos[i] = i < INODE_BLOCKS ? INODE_START_BLOCK + i : BITMAP_BLOCK;
+    bufs[i] = buf;
+  }
+  b_rw_batch(VIRTIO_BLK_T_OUT, bnos, bufs, INODE_BLOCKS + 1);
+  memset(icache, 0, sizeof(icache));
 
   // init superblock
   sb.magic = FSS_MAGIC;
@@ -357,13 +575,7 @@ static void fs_format(void) {
 
 void fs_init(void) {
   INFO("fs: init start");
-  // reset fd table
-  for (int i = 0; i < FS_MAX_FILES; i++) {
-    fs_fds[i].used = 0;
-    fs_fds[i].inum = 0;
-    fs_fds[i].offset = 0;
-  }
-
+  memset(icache, 0, sizeof(icache));
   char buf[BSIZE];
   if (b_read(SB_BLOCK, buf) < 0) {
     INFO("fs: no superblock, format new fs");
@@ -379,122 +591,223 @@ void fs_init(void) {
   }
 }
 
-static int fs_alloc_fd(uint32_t inum) {
-  for (int i = 0; i < FS_MAX_FILES; i++) {
-    if (!fs_fds[i].used) {
-      fs_fds[i].used = 1;
-      fs_fds[i].inum = inum;
-      fs_fds[i].offset = 0;
-      // external-facing fd is offset by FS_FD_BASE so that 0,1,2
-      // can be reserved for stdin/stdout/stderr
-      return FS_FD_BASE + i;
-    }
-  }
-  return -1;
+// common path of all reads and writes: off < 0 uses and advances the file offset
+static int64_t inode_file_rw(struct file *f, const struct iovec *iov, int iovcnt, int64_t off,
+                             int write) {
+  if (off > (int64_t)MAXFILE * BSIZE)
+    return write ? -1 : 0;
+  fs_lock();
+  uint32_t pos = off < 0 ? f->offset : (uint32_t)off;
+  int r = write ? inode_writev(f->inum, iov, iovcnt, pos) : inode_readv(f->inum, iov, iovcnt, pos);
+  if (r > 0 && off < 0)
+    f->offset += (uint32_t)r;
+  fs_unlock();
+  return r;
 }
 
-int fs_create(const char *name) {
-  if (!name)
-    return -1;
-  uint32_t existing;
-  if (dir_lookup(name, &existing) == 0)
-    return -1;
+static int64_t inode_file_read(struct file *f, const struct iovec *iov, int iovcnt, int64_t off) {
+  return inode_file_rw(f, iov, iovcnt, off, 0);
+}
 
-  uint32_t inum;
-  if (ialloc(1, &inum) < 0)
-    return -1;
-  if (dir_add(name, inum) < 0)
-    return -1;
-  return fs_alloc_fd(inum);
+static int64_t inode_file_write(struct file *f, const struct iovec *iov, int iovcnt,
+                                int64_t off) {
+  return inode_file_rw(f, iov, iovcnt, off, 1);
 }
 
-int fs_open(const char *name) {
-  if (!name)
+static int64_t inode_file_lseek(struct file *f, int64_t off, int whence) {
+  int64_t base;
+  if (whence == SEEK_SET) {
+    base = 0;
+  } else if (whence == SEEK_CUR) {
+    base = f->offset;
+  } else if (whence == SEEK_END) {
+    struct dinode din;
+    fs_lock();
+    int r = read_dinode(f->inum, &din);
+    fs_unlock();
+    if (r < 0)
+      return -1;
+    base = din.size;
+  } else {
     return -1;
-  uint32_t inum;
-  if (dir_lookup(name, &inum) < 0)
+  }
+  int64_t pos = base + off;
+  if (pos < 0 || pos > (int64_t)MAXFILE * BSIZE)
     return -1;
-  return fs_alloc_fd(inum);
+  f->offset = (uint32_t)pos;
+  return pos;
 }
 
-int fs_read(int fd, void *buf, int n) {
-  if (fd < FS_FD_BASE || fd >= FS_FD_BASE + FS_MAX_FILES || !buf || n < 0)
+/* copy len bytes from in at *in_off to out at *out_off, advancing both, block by block
+ * without going through user memory. Whole aligned blocks move with one device read and
+ * one write (a hole stays a hole if the destination has none there yet); partial blocks
+ * are merged into the destination block. Overlapping ranges of one file are refused.
+ */
+static int64_t copy_range_locked(struct file *in, uint32_t *in_off, struct file *out,
+                                 uint32_t *out_off, uint64_t len) {
+  if (in->type != FILE_INODE || out->type != FILE_INODE)
     return -1;
-  FSFileDesc *d = &fs_fds[fd - FS_FD_BASE];
-  if (!d->used)
+  int same = in->inum == out->inum;
+  struct dinode sdin, ddin;
+  struct dinode *sd = &sdin, *dd = same ? &sdin : &ddin;
+  if (read_dinode(in->inum, sd) < 0 || (!same && read_dinode(out->inum, dd) < 0))
     return -1;
-  int r = inode_read(d->inum, buf, d->offset, (uint32_t)n);
-  if (r > 0)
-    d->offset += (uint32_t)r;
-  return r;
-}
-
-int fs_write(int fd, const void *buf, int n) {
-  if (fd < FS_FD_BASE || fd >= FS_FD_BASE + FS_MAX_FILES || !buf || n < 0)
+  uint32_t so = *in_off, doff = *out_off;
+  if (so >= sd->size)
+    return 0;
+  uint32_t n = len < sd->size - so ? (uint32_t)len : sd->size - so;
+  if ((uint64_t)doff + n > (uint64_t)MAXFILE * BSIZE)
+    n = doff >= MAXFILE * BSIZE ? 0 : MAXFILE * BSIZE - doff;
+  if (same && so < doff + n && doff < so + n)
     return -1;
-  FSFileDesc *d = &fs_fds[fd - FS_FD_BASE];
-  if (!d->used)
+
+  char sbuf[BSIZE], dbuf[BSIZE];
+  uint32_t dsize = dd->size; // before this copy
+  uint32_t tot = 0;
+  while (tot < n) {
+    uint32_t sboff = (so + tot) % BSIZE, dboff = (doff + tot) % BSIZE;
+    uint32_t m = BSIZE - (sboff > dboff ? sboff : dboff);
+    if (m > n - tot)
+      m = n - tot;
+    uint32_t sbno = bmap(sd, (so + tot) / BSIZE, 0);
+    if (m == BSIZE && !sbno && !bmap(dd, (doff + tot) / BSIZE, 0)) {
+      tot += m; // hole onto hole
+      continue;
+    }
+    uint32_t dblk = (doff + tot) / BSIZE;
+    int fresh = bmap(dd, dblk, 0) == 0;
+    uint32_t dbno = bmap(dd, dblk, 1);
+    if (dbno == 0)
+      break;
+    if (m == BSIZE) {
+      // whole block: the source block is the destination block's new content
+      if (!sbno)
+        memset(dbuf, 0, BSIZE);
+      else if (b_read(sbno, dbuf) < 0)
+        break;
+    } else {
+      if (!sbno)
+        memset(sbuf, 0, BSIZE);
+      else if (b_read(sbno, sbuf) < 0)
+        break;
+      if (fresh)
+        memset(dbuf, 0, BSIZE);
+      else if (b_read(dbno, dbuf) < 0)
+        break;
+      else
+        zero_gap(dbuf, dblk, dsize, dboff);
+      memcpy(dbuf + dboff, sbuf + sboff, m);
+    }
+    if (b_write(dbno, dbuf) < 0)
+      break;
+    tot += m;
+  }
+  if (doff + tot > dd->size)
+    dd->size = doff + tot;
+  if (write_dinode(out->inum, dd) < 0)
     return -1;
-  int r = inode_write(d->inum, buf, d->offset, (uint32_t)n);
-  if (r > 0)
-    d->offset += (uint32_t)r;
+  *in_off = so + tot;
+  *out_off = doff + tot;
+  return tot == 0 && n > 0 ? -1 : (int64_t)tot;
+}
+
+int64_t fs_copy_range(struct file *in, uint32_t *in_off, struct file *out, uint32_t *out_off,
+                      uint64_t len) {
+  fs_lock();
+  int64_t r = copy_range_locked(in, in_off, out, out_off, len);
+  fs_unlock();
   return r;
 }
 
-int fs_close(int fd) {
-  if (fd < FS_FD_BASE || fd >= FS_FD_BASE + FS_MAX_FILES)
-    return -1;
-  FSFileDesc *d = &fs_fds[fd - FS_FD_BASE];
-  if (!d->used)
-    return -1;
-  d->used = 0;
-  d->inum = 0;
-  d->offset = 0;
-  return 0;
+static const struct file_ops inode_file_ops = {
+    .read = inode_file_read,
+    .write = inode_file_write,
+    .lseek = inode_file_lseek,
+    .poll = NULL,    // disk I/O never waits for another process: always ready
+    .release = NULL, // no in-core inode to drop
+};
+
+// inode of name, created (and required not to exist) with create
+static int open_locked(const char *name, int create, uint32_t *inum) {
+  if (create) {
+    if (dir_lookup(name, inum) == 0)
+      return -1;
+    if (ialloc(1, inum) < 0)
+      return -1;
+    if (dir_add(name, *inum) < 0)
+      return -1;
+    return 0;
+  }
+  return dir_lookup(name, inum);
 }
 
-// unlink a file in root directory: remove dirent and free its inode data blocks
-int fs_unlink(const char *name) {
+struct file *fs_open(const char *name, int create) {
   if (!name)
-    return -1;
-
-  // first locate inode by name using same logic as fs_open/fs_create
-  uint32_t inum = 0;
-  if (dir_lookup(name, &inum) < 0)
-    return -1;
-
-  if (inum == 0)
-    return -1;
-
-  struct dinode din;
-  if (read_dinode(inum, &din) < 0)
-    return -1;
+    return NULL;
+  uint32_t inum;
+  fs_lock();
+  int r = open_locked(name, create, &inum);
+  fs_unlock();
+  if (r < 0)
+    return NULL;
+  struct file *f = file_alloc(FILE_INODE, &inode_file_ops);
+  if (!f)
+    return NULL;
+  f->inum = inum;
+  return f;
+}
 
+// free every block of the inode and make it empty (the caller writes it back)
+static void inode_trunc_blocks(struct dinode *dip) {
   // free all direct data blocks
   for (int i = 0; i < NDIRECT; i++) {
-    uint32_t bno = din.addrs[i];
+    uint32_t bno = dip->addrs[i];
     if (bno != 0) {
       b_free(bno);
-      din.addrs[i] = 0;
+      dip->addrs[i] = 0;
     }
   }
   // free indirect blocks and the data blocks they point to
-  if (din.indirect != 0) {
+  if (dip->indirect != 0) {
     char buf[BSIZE];
-    if (b_read(din.indirect, buf) == 0) {
+    if (b_read(dip->indirect, buf) == 0) {
       uint32_t *a = (uint32_t *)buf;
       for (uint32_t i = 0; i < NINDIRECT; i++) {
         if (a[i] != 0)
           b_free(a[i]);
       }
     }
-    b_free(din.indirect);
-    din.indirect = 0;
+    b_free(dip->indirect);
+    dip->indirect = 0;
   }
-  din.size = 0;
+  dip->size = 0;
+}
+
+static int inode_free(uint32_t inum) {
+  struct dinode din;
+  if (read_dinode(inum, &din) < 0)
+    return -1;
+
+  inode_trunc_blocks(&din);
   din.type = 0; // mark inode as free
   din.nlink = 0;
-  if (write_dinode(inum, &din) < 0)
+  return write_dinode(inum, &din);
+}
+
+// unlink a file in root directory: remove dirent and free its inode data blocks
+static int unlink_locked(const char *name) {
+  if (!name)
+    return -1;
+
+  // first locate inode by name using same logic as fs_open/fs_create
+  uint32_t inum = 0;
+  if (dir_lookup(name, &inum) < 0)
+    return -1;
+
+  if (inum == 0)
+    return -1;
+
+  if (inode_free(inum) < 0)
     return -1;
 
   // finally remove the directory entry pointing to this inode
@@ -504,9 +817,110 @@ int fs_unlink(const char *name) {
   return 0;
 }
 
-// truncate file (set size to 0) without freeing data blocks (they will be reused on next
-// writes); only visible size is affected.
-int fs_trunc(const char *name) {
+int fs_unlink(const char *name) {
+  fs_lock();
+  int r = unlink_locked(name);
+  fs_unlock();
+  return r;
+}
+
+// blocks the inode occupies on disk: data blocks plus the indirect block itself
+static int inode_nblocks(const struct dinode *din) {
+  int n = 0;
+  for (int i = 0; i < NDIRECT; i++)
+    n += din->addrs[i] != 0;
+  if (din->indirect) {
+    char buf[BSIZE];
+    if (b_read(din->indirect, buf) < 0)
+      return -1;
+    uint32_t *a = (uint32_t *)buf;
+    n++;
+    for (uint32_t i = 0; i < NINDIRECT; i++)
+      n += a[i] != 0;
+  }
+  return n;
+}
+
+static int stat_locked(uint32_t inum, struct stat *st) {
+  struct dinode din;
+  if (read_dinode(inum, &din) < 0 || din.type == 0)
+    return -1;
+  struct icache_entry *ic = &icache[inum];
+  if (ic->nblocks < 0)
+    ic->nblocks = inode_nblocks(&din);
+  memset(st, 0, sizeof(*st));
+  st->ino = inum;
+  st->type = din.type;
+  st->nlink = din.nlink;
+  st->size = din.size;
+  st->blocks = ic->nblocks < 0 ? 0 : (uint32_t)ic->nblocks;
+  return 0;
+}
+
+int fs_stat_inode(uint32_t inum, struct stat *st) {
+  fs_lock();
+  int r = stat_locked(inum, st);
+  fs_unlock();
+  return r;
+}
+
+uint32_t fs_inode_gen(uint32_t inum) { return inum < NINODE ? icache[inum].gen : 0; }
+
+int fs_stat(const char *name, struct stat *st) {
+  uint32_t inum;
+  if (!name || !st)
+    return -1;
+  fs_lock();
+  int r = dir_lookup(name, &inum) < 0 ? -1 : stat_locked(inum, st);
+  fs_unlock();
+  return r;
+}
+
+/* rename: only directory entries change, the file's inode and data stay where they are.
+ * Without a destination the source dirent is rewritten in place. Otherwise the
+ * destination dirent is pointed at the source inode first, so that new always names
+ * either the old or the new file, then the source entry and the replaced inode go.
+ * The fs lock is held throughout, so no other process sees an intermediate state.
+ */
+static int rename_locked(const char *oldname, const char *newname) {
+  if (!oldname || !newname || !newname[0])
+    return -1;
+  uint32_t inum, off;
+  if (dir_find(oldname, &inum, &off) < 0)
+    return -1;
+  if (namecmp(oldname, newname) == 0)
+    return 0;
+
+  uint32_t root = sb.root_inum;
+  struct dirent de;
+  uint32_t dst_inum, dst_off;
+  if (dir_find(newname, &dst_inum, &dst_off) < 0) {
+    de.inum = inum;
+    memset(de.name, 0, sizeof(de.name));
+    dirent_set_name(&de, newname);
+    return inode_write(root, &de, off, sizeof(de)) == (int)sizeof(de) ? 0 : -1;
+  }
+  if (dst_inum == inum)
+    return 0;
+
+  // replace: the inum field is 4-byte aligned, so each of these is a single block write
+  if (inode_write(root, &inum, dst_off, sizeof(inum)) != (int)sizeof(inum))
+    return -1;
+  uint32_t zero = 0;
+  if (inode_write(root, &zero, off, sizeof(zero)) != (int)sizeof(zero))
+    return -1;
+  return inode_free(dst_inum);
+}
+
+int fs_rename(const char *oldname, const char *newname) {
+  fs_lock();
+  int r = rename_locked(oldname, newname);
+  fs_unlock();
+  return r;
+}
+
+// truncate file to size 0, freeing its data and indirect blocks
+static int trunc_locked(const char *name) {
   if (!name)
     return -1;
 
@@ -520,15 +934,23 @@ int fs_trunc(const char *name) {
   if (read_dinode(inum, &din) < 0)
     return -1;
 
-  din.size = 0;
+  // blocks kept past the size would read back as old data once a write skips over them
+  inode_trunc_blocks(&din);
   if (write_dinode(inum, &din) < 0)
     return -1;
 
   return 0;
 }
 
+int fs_trunc(const char *name) {
+  fs_lock();
+  int r = trunc_locked(name);
+  fs_unlock();
+  return r;
+}
+
 // enumerate entries in the root directory
-int fs_list_root(struct dirent *ents, int max_ents) {
+static int list_root_locked(struct dirent *ents, int max_ents) {
   if (!ents || max_ents <= 0)
     return -1;
 
@@ -552,3 +974,10 @@ int fs_list_root(struct dirent *ents, int max_ents) {
   }
   return count;
 }
+
+int fs_list_root(struct dirent *ents, int max_ents) {
+  fs_lock();
+  int r = list_root_locked(ents, max_ents);
+  fs_unlock();
+  return r;
+}
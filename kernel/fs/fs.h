@@ -16,20 +16,9 @@
 
 #include <stdint.h>
 
-// maximum number of simultaneously open file descriptors managed by filesystem
-// file descriptors returned to user space start from FS_FD_BASE (so 0,1,2 can
-// be reserved for stdin/stdout/stderr)
-#define FS_MAX_FILES 16
-#define FS_FD_BASE 3
 // maximum filename length (including terminating '\0')
 #define FS_NAME_MAX 16
 
-typedef struct {
-  int used;
-  uint32_t inum;   // inode number on disk
-  uint32_t offset; // current read/write offset
-} FSFileDesc;
-
 // On-disk layout (very small, for 64KB disk.img):
 // block 0: superblock
 // blocks [1..4]: inode table
@@ -64,9 +53,16 @@ struct superblock {
   uint32_t root_inum; // inode number of root directory
 };
 
+// inode / stat types
+#define T_FILE 1
+#define T_DIR 2
+#define T_DEV 3   // console (stat only)
+#define T_PIPE 4  // pipe end (stat only)
+#define T_EPOLL 5 // epoll set (stat only)
+
 // on-disk inode
 struct dinode {
-  uint16_t type;           // 0: free, 1: file, 2: directory
+  uint16_t type;           // 0: free, T_FILE, T_DIR
   uint16_t nlink;          // not really used yet
   uint32_t size;           // size in bytes
   uint32_t addrs[NDIRECT]; // direct data blocks
@@ -78,19 +74,58 @@ struct dirent {
   char name[FS_NAME_MAX];
 };
 
-static struct superblock sb;
-static FSFileDesc fs_fds[FS_MAX_FILES];
+// file metadata returned by stat/fstat
+struct stat {
+  uint32_t ino;    // inode number, 0 for files that are not on disk
+  uint16_t type;   // T_*
+  uint16_t nlink;
+  uint32_t size;   // bytes
+  uint32_t blocks; // BSIZE blocks allocated on disk (data and indirect)
+};
+
+// one buffer of a vectored read/write (readv/writev)
+struct iovec {
+  void *iov_base;
+  uint64_t iov_len;
+};
+// most segments in one vectored call
+#define FS_IOV_MAX 16
+
+// lseek whence
+#define SEEK_SET 0
+#define SEEK_CUR 1
+#define SEEK_END 2
 
 void fs_init(void);
-int fs_create(const char *name);
-int fs_open(const char *name);
-int fs_read(int fd, void *buf, int n);
-int fs_write(int fd, const void *buf, int n);
-int fs_close(int fd);
+
+struct file;
+/* open a file of the root directory (create != 0: a new one, failing if the name
+ * exists) as a new open file (file.h) at offset 0; NULL on error. Its reads and
+ * writes fill/drain the iovec segments in order and transfer every block once;
+ * seeking past the end is allowed and a later write leaves a hole that reads as zeros.
+ */
+struct file *fs_open(const char *name, int create);
+/* copy up to len bytes between two open disk files at the given offsets (advanced by the
+ * amount copied), inside the kernel and a block at a time; returns bytes copied, 0 at the
+ * end of in, or -1 (not disk files, overlapping ranges of one file, I/O error)
+ */
+int64_t fs_copy_range(struct file *in, uint32_t *in_off, struct file *out, uint32_t *out_off,
+                      uint64_t len);
 
 // remove a file from root directory (unlink)
 int fs_unlink(const char *name);
 
+// metadata of a file by name / by inode number, from the in-core inode cache
+int fs_stat(const char *name, struct stat *st);
+int fs_stat_inode(uint32_t inum, struct stat *st);
+// changes whenever the inode (size, blocks, link) is written: every data write, truncate
+// and free goes through it, so caches of file contents compare it to see staleness
+uint32_t fs_inode_gen(uint32_t inum);
+
+// rename a file of the root directory, replacing newname if it exists; only
+// directory entries are written, so it takes constant time whatever the file size
+int fs_rename(const char *oldname, const char *newname);
+
 // truncate file (set size to 0) by name in root directory
 int fs_trunc(const char *name);
 
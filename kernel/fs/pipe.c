@@ -0,0 +1,181 @@
+/*
+ * Lrix
+ * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+ *
+ * This program is released under the terms of the GNU General Public License version 2(GPLv2).
+ * See https://opensource.org/licenses/GPL-2.0 for more information.
+ *
+ * Project homepage: https://github.com/lrisguan/Lrix
+ * Description: A scratch implemention of OS based on RISC-V
+ */
+
+// pipe.c - in-kernel pipes with blocking readers and writers
+//
+// Each end is one open file; dup/fork/spawn share it through its refcount, so the pipe
+// only learns when the last fd of an end is closed. Everything here runs with
+// interrupts off (syscalls, fork, exit); only the sleeps in the read/write ops let
+// other processes run, and interrupts are off again when they return.
+
+#include "pipe.h"
+#include "poll.h"
+#include "../include/riscv.h"
+#include "../mem/kmem.h"
+#include "../proc/proc.h"
+#include "../string/string.h"
+
+#define PIPE_SIZE PAGE_SIZE
+
+struct pipe {
+  int used;
+  char *buf;       // PIPE_SIZE byte ring (one page)
+  uint32_t nread;  // bytes read so far (free running)
+  uint32_t nwrite; // bytes written so far
+  int readers;     // read end still open
+  int writers;     // write end still open
+  waitqueue rwq;   // readers waiting for data
+  waitqueue wwq;   // writers waiting for space
+};
+
+static struct pipe pipes[PIPE_MAX];
+
+static int64_t pipe_read(struct file *f, const struct iovec *iov, int iovcnt, int64_t off) {
+  struct pipe *pp = f->pipe;
+  if (off >= 0)
+    return -1;
+  while (pp->nwrite == pp->nread && pp->writers > 0) {
+    proc_sleep_on(&pp->rwq, 0);
+    intr_off();
+  }
+
+  // take what is there, filling the segments in order
+  int64_t tot = 0;
+  for (int i = 0; i < iovcnt && pp->nread != pp->nwrite; i++) {
+    char *dst = (char *)iov[i].iov_base;
+    uint64_t j = 0;
+    for (; j < iov[i].iov_len && pp->nread != pp->nwrite; j++)
+      dst[j] = pp->buf[pp->nread++ % PIPE_SIZE];
+    tot += (int64_t)j;
+  }
+  if (tot)
+    proc_wakeup(&pp->wwq, -1);
+  return tot;
+}
+
+static int64_t pipe_write(struct file *f, const struct iovec *iov, int iovcnt, int64_t off) {
+  struct pipe *pp = f->pipe;
+  if (off >= 0)
+    return -1;
+
+  int64_t tot = 0;
+  for (int i = 0; i < iovcnt; i++) {
+    const char *src = (const char *)iov[i].iov_base;
+    uint64_t done = 0;
+    while (done < iov[i].iov_len) {
+      if (pp->readers <= 0)
+        return tot ? tot : -1;
+      uint32_t space = PIPE_SIZE - (pp->nwrite - pp->nread);
+      if (space == 0) {
+        proc_sleep_on(&pp->wwq, 0);
+        intr_off();
+        continue;
+      }
+      uint64_t m = iov[i].iov_len - done < space ? iov[i].iov_len - done : space;
+      for (uint64_t j = 0; j < m; j++)
+        pp->buf[(pp->nwrite + j) % PIPE_SIZE] = src[done + j];
+      pp->nwrite += (uint32_t)m;
+      done += m;
+      tot += (int64_t)m;
+      proc_wakeup(&pp->rwq, -1);
+    }
+  }
+  return tot;
+}
+
+static uint32_t pipe_poll_read(struct file *f, poll_table *pt) {
+  struct pipe *pp = f->pipe;
+  poll_wait(pt, &pp->rwq);
+  uint32_t mask = pp->nwrite != pp->nread ? POLLIN : 0;
+  if (pp->writers <= 0)
+    mask |= POLLIN | POLLHUP; // reads return 0 now
+  return mask;
+}
+
+static uint32_t pipe_poll_write(struct file *f, poll_table *pt) {
+  struct pipe *pp = f->pipe;
+  poll_wait(pt, &pp->wwq);
+  if (pp->readers <= 0)
+    return POLLERR;
+  return pp->nwrite - pp->nread < PIPE_SIZE ? POLLOUT : 0;
+}
+
+static void pipe_put(struct pipe *pp) {
+  if (pp->readers > 0 || pp->writers > 0)
+    return;
+  kfree(pp->buf);
+  pp->buf = NULL;
+  pp->used = 0;
+}
+
+// the other side has to notice: readers see EOF, writers lose their reader
+static void pipe_release_read(struct file *f) {
+  struct pipe *pp = f->pipe;
+  if (!pp)
+    return;
+  pp->readers = 0;
+  proc_wakeup(&pp->wwq, -1);
+  pipe_put(pp);
+}
+
+static void pipe_release_write(struct file *f) {
+  struct pipe *pp = f->pipe;
+  if (!pp)
+    return;
+  pp->writers = 0;
+  proc_wakeup(&pp->rwq, -1);
+  pipe_put(pp);
+}
+
+static const struct file_ops pipe_read_ops = {
+    .read = pipe_read,
+    .write = NULL,
+    .lseek = NULL,
+    .poll = pipe_poll_read,
+    .release = pipe_release_read,
+};
+
+static const struct file_ops pipe_write_ops = {
+    .read = NULL,
+    .write = pipe_write,
+    .lseek = NULL,
+    .poll = pipe_poll_write,
+    .release = pipe_release_write,
+};
+
+int pipe_alloc(struct file **rf, struct file **wf) {
+  struct pipe *pp = NULL;
+  for (int i = 0; i < PIPE_MAX && !pp; i++)
+    if (!pipes[i].used)
+      pp = &pipes[i];
+  if (!pp)
+    return -1;
+
+  struct file *r = file_alloc(FILE_PIPE, &pipe_read_ops);
+  struct file *w = r ? file_alloc(FILE_PIPE, &pipe_write_ops) : NULL;
+  char *buf = w ? (char *)kalloc() : NULL;
+  if (!buf) {
+    // not attached to pp yet, so releasing them touches no pipe
+    file_close(r);
+    file_close(w);
+    return -1;
+  }
+  memset(pp, 0, sizeof(*pp));
+  pp->used = 1;
+  pp->buf = buf;
+  pp->readers = 1;
+  pp->writers = 1;
+  r->pipe = pp;
+  w->pipe = pp;
+  *rf = r;
+  *wf = w;
+  return 0;
+}
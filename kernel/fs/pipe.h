@@ -0,0 +1,29 @@
+/*
+ * Lrix
+ * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+ *
+ * This program is released under the terms of the GNU General Public License version 2(GPLv2).
+ * See https://opensource.org/licenses/GPL-2.0 for more information.
+ *
+ * Project homepage: https://github.com/lrisguan/Lrix
+ * Description: A scratch implemention of OS based on RISC-V
+ */
+
+// pipe.h - in-kernel pipes: a page-sized ring buffer between a read and a write end
+
+#ifndef _PIPE_H_
+#define _PIPE_H_
+
+#include "file.h"
+
+#define PIPE_MAX 8 // pipes in the whole system
+
+/* create a pipe as two open files (file.h), *rf the read end and *wf the write end.
+ * Reads sleep while the pipe is empty and a writer is left, and return 0 at end of
+ * file. Writes sleep while it is full and transfer everything, unless the last reader
+ * goes away (the bytes written so far, or -1 if there was no reader at all).
+ * Returns 0, or -1 if no pipe or open file is free.
+ */
+int pipe_alloc(struct file **rf, struct file **wf);
+
+#endif /* _PIPE_H_ */
@@ -0,0 +1,288 @@
+/*
+ * Lrix
+ * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+ *
+ * This program is released under the terms of the GNU General Public License version 2(GPLv2).
+ * See https://opensource.org/licenses/GPL-2.0 for more information.
+ *
+ * Project homepage: https://github.com/lrisguan/Lrix
+ * Description: A scratch implemention of OS based on RISC-V
+ */
+
+// poll.c - poll() and epoll sets on top of file_ops.poll
+//
+// Called from syscalls with interrupts off, so a file cannot become ready between its
+// poll op and the sleep: the wakeup finds the waiter already registered.
+
+#include "poll.h"
+#include "../include/riscv.h"
+#include "../mem/kmem.h"
+#include "../proc/proc.h"
+#include "../string/string.h"
+
+// errors and hangups are reported whether asked for or not
+#define POLL_ALWAYS (POLLERR | POLLHUP)
+
+uint32_t file_poll(struct file *f, poll_table *pt) {
+  if (!f->ops->poll)
+    return POLLIN | POLLOUT;
+  return f->ops->poll(f, pt);
+}
+
+// deadline for proc_sleep: 0 = none
+static uint64_t poll_deadline(int64_t timeout) {
+  return timeout > 0 ? read_mtime() + (uint64_t)timeout : 0;
+}
+
+// ---- poll ----
+
+// poll() registers the caller on every queue, with the entries on its kernel stack
+struct poll_wqueues {
+  poll_table pt;
+  int n;
+  wait_entry entries[POLL_MAX];
+};
+
+static void poll_qproc(poll_table *pt, waitqueue *wq) {
+  struct poll_wqueues *pw = (struct poll_wqueues *)pt;
+  if (pw->n < POLL_MAX)
+    wq_add(wq, &pw->entries[pw->n++], 0);
+}
+
+// one pass over fds; registers on the queues through pt if given
+static int poll_scan(PCB *p, struct pollfd *fds, int nfds, poll_table *pt) {
+  int ready = 0;
+  for (int i = 0; i < nfds; i++) {
+    struct file *f = fd_get(p, fds[i].fd);
+    uint32_t mask;
+    if (fds[i].fd < 0)
+      mask = 0; // ignored entry, as in POSIX
+    else if (!f)
+      mask = POLLNVAL;
+    else
+      mask = file_poll(f, pt) & ((uint16_t)fds[i].events | POLL_ALWAYS);
+    fds[i].revents = (short)mask;
+    if (mask)
+      ready++;
+  }
+  return ready;
+}
+
+int64_t fd_poll(PCB *p, struct pollfd *fds, int nfds, int64_t timeout) {
+  if (!fds || nfds < 0 || nfds > POLL_MAX)
+    return -1;
+  uint64_t deadline = poll_deadline(timeout);
+  for (;;) {
+    intr_off();
+    if (timeout == 0)
+      return poll_scan(p, fds, nfds, NULL);
+    struct poll_wqueues pw;
+    pw.pt.qproc = poll_qproc;
+    pw.n = 0;
+    int ready = poll_scan(p, fds, nfds, &pw.pt);
+    if (ready) {
+      wq_remove_all(get_current_proc());
+      return ready;
+    }
+    // woken by any of the queues (or timed out): scan again, a last time on timeout
+    if (proc_sleep(deadline) < 0) {
+      intr_off();
+      return poll_scan(p, fds, nfds, NULL);
+    }
+  }
+}
+
+// ---- epoll ----
+
+struct epitem {
+  int used;
+  int fd;            // as given to EPOLL_CTL_ADD (the key of the item)
+  struct file *file; // referenced while in the set
+  uint32_t events;
+  uint64_t data;
+  int ready;         // on the ready list
+  struct epitem *rdnext;
+  wait_entry we;     // callback entry on the file's wait queue
+  struct epoll *ep;
+};
+
+struct epoll {
+  struct epitem items[EPOLL_MAX];
+  struct epitem *rdlist; // items that may be ready, checked by epoll_wait
+  waitqueue wq;          // processes in epoll_wait
+};
+
+_Static_assert(sizeof(struct epoll) <= PAGE_SIZE, "epoll set must fit in one page");
+
+static void ep_set_ready(struct epitem *it) {
+  if (it->ready)
+    return;
+  it->ready = 1;
+  it->rdnext = it->ep->rdlist;
+  it->ep->rdlist = it;
+}
+
+// wakeup of a watched file: only this item needs a look, the rest of the set stays idle
+static void ep_poll_callback(wait_entry *we) {
+  struct epitem *it = (struct epitem *)((char *)we - __builtin_offsetof(struct epitem, we));
+  ep_set_ready(it);
+  proc_wakeup(&it->ep->wq, -1);
+}
+
+struct ep_pqueue {
+  poll_table pt;
+  struct epitem *it;
+};
+
+static void ep_qproc(poll_table *pt, waitqueue *wq) {
+  struct epitem *it = ((struct ep_pqueue *)pt)->it;
+  if (!it->we.wq)
+    wq_add_func(wq, &it->we, ep_poll_callback);
+}
+
+static void ep_remove(struct epitem *it) {
+  struct epoll *ep = it->ep;
+  wq_remove(&it->we);
+  if (it->ready) {
+    struct epitem **pp = &ep->rdlist;
+    while (*pp != it)
+      pp = &(*pp)->rdnext;
+    *pp = it->rdnext;
+  }
+  file_close(it->file);
+  memset(it, 0, sizeof(*it));
+}
+
+static uint32_t ep_file_poll(struct file *f, poll_table *pt) {
+  poll_wait(pt, &f->ep->wq);
+  return f->ep->rdlist ? POLLIN : 0;
+}
+
+static void ep_file_release(struct file *f) {
+  for (int i = 0; i < EPOLL_MAX; i++)
+    if (f->ep->items[i].used)
+      ep_remove(&f->ep->items[i]);
+  kfree(f->ep);
+  f->ep = NULL;
+}
+
+static const struct file_ops epoll_ops = {
+    .read = NULL,
+    .write = NULL,
+    .lseek = NULL,
+    .poll = ep_file_poll,
+    .release = ep_file_release,
+};
+
+int64_t epoll_create(PCB *p) {
+  struct epoll *ep = (struct epoll *)kalloc();
+  if (!ep)
+    return -1;
+  memset(ep, 0, sizeof(*ep));
+  struct file *f = file_alloc(FILE_EPOLL, &epoll_ops);
+  if (!f) {
+    kfree(ep);
+    return -1;
+  }
+  f->ep = ep;
+  int fd = fd_install(p, f, 0);
+  if (fd < 0)
+    file_close(f);
+  return fd;
+}
+
+static struct epitem *ep_find(struct epoll *ep, int fd) {
+  for (int i = 0; i < EPOLL_MAX; i++)
+    if (ep->items[i].used && ep->items[i].fd == fd)
+      return &ep->items[i];
+  return NULL;
+}
+
+int64_t epoll_ctl(PCB *p, int epfd, int op, int fd, const struct epoll_event *ev) {
+  struct file *epf = fd_get(p, epfd);
+  struct file *f = fd_get(p, fd);
+  if (!epf || epf->type != FILE_EPOLL || !f || f == epf)
+    return -1;
+  struct epoll *ep = epf->ep;
+  struct epitem *it = ep_find(ep, fd);
+
+  if (op == EPOLL_CTL_DEL) {
+    if (!it)
+      return -1;
+    ep_remove(it);
+    return 0;
+  }
+  if (!ev || (op == EPOLL_CTL_MOD && !it) || (op == EPOLL_CTL_ADD && it))
+    return -1;
+  if (op == EPOLL_CTL_ADD) {
+    for (int i = 0; i < EPOLL_MAX && !it; i++)
+      if (!ep->items[i].used)
+        it = &ep->items[i];
+    if (!it)
+      return -1;
+    it->used = 1;
+    it->fd = fd;
+    it->file = file_dup(f);
+    it->ep = ep;
+  } else if (op != EPOLL_CTL_MOD) {
+    return -1;
+  }
+  it->events = ev->events;
+  it->data = ev->data;
+
+  // hook the file's queue (first time only) and pick up readiness that is already there
+  struct ep_pqueue epq = {{ep_qproc}, it};
+  if (file_poll(it->file, &epq.pt) & (it->events | POLL_ALWAYS)) {
+    ep_set_ready(it);
+    proc_wakeup(&ep->wq, -1);
+  }
+  return 0;
+}
+
+/* move ready items to evs. Level triggered: an item that still reports events stays on
+ * the ready list for the next call, one that does not is dropped until its next wakeup.
+ */
+static int ep_collect(struct epoll *ep, struct epoll_event *evs, int max) {
+  struct epitem *list = ep->rdlist;
+  ep->rdlist = NULL;
+  int n = 0;
+  while (list) {
+    struct epitem *it = list;
+    list = it->rdnext;
+    it->ready = 0;
+    uint32_t mask = n < max ? file_poll(it->file, NULL) & (it->events | POLL_ALWAYS) : 1;
+    if (!mask)
+      continue;
+    if (n < max) {
+      evs[n].events = mask;
+      evs[n].data = it->data;
+      n++;
+    }
+    ep_set_ready(it);
+  }
+  return n;
+}
+
+// the set is held referenced while the caller sleeps on it: another thread may close epfd
+int64_t epoll_wait(PCB *p, int epfd, struct epoll_event *evs, int max, int64_t timeout) {
+  struct file *epf = fget(p, epfd);
+  if (!epf || epf->type != FILE_EPOLL || !evs || max <= 0) {
+    file_close(epf);
+    return -1;
+  }
+  uint64_t deadline = poll_deadline(timeout);
+  int n;
+  for (;;) {
+    intr_off();
+    n = ep_collect(epf->ep, evs, max);
+    if (n || timeout == 0)
+      break;
+    if (proc_sleep_on(&epf->ep->wq, deadline) < 0) {
+      intr_off();
+      n = ep_collect(epf->ep, evs, max);
+      break;
+    }
+  }
+  file_close(epf);
+  return n;
+}
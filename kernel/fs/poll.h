@@ -0,0 +1,87 @@
+/*
+ * Lrix
+ * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+ *
+ * This program is released under the terms of the GNU General Public License version 2(GPLv2).
+ * See https://opensource.org/licenses/GPL-2.0 for more information.
+ *
+ * Project homepage: https://github.com/lrisguan/Lrix
+ * Description: A scratch implemention of OS based on RISC-V
+ */
+
+// poll.h - readiness multiplexing: poll() over a list of fds and epoll interest sets
+//
+// Every file answers "what could I do now" through file_ops.poll, which also hands the
+// wait queues that signal a change to a poll_table. poll() puts the caller to sleep on
+// all of them at once; an epoll set keeps a callback entry on each queue instead, so a
+// wakeup only marks that one file ready and the set is not rescanned.
+
+#ifndef _POLL_H_
+#define _POLL_H_
+
+#include "file.h"
+#include <stdint.h>
+
+// events / revents (epoll uses the same bits)
+#define POLLIN 0x001   // data to read (or end of file)
+#define POLLOUT 0x004  // room to write
+#define POLLERR 0x008  // write end without reader (always reported)
+#define POLLHUP 0x010  // read end without writer (always reported)
+#define POLLNVAL 0x020 // fd not open (poll only)
+
+#define EPOLLIN POLLIN
+#define EPOLLOUT POLLOUT
+#define EPOLLERR POLLERR
+#define EPOLLHUP POLLHUP
+
+// most fds in one poll() call / watched by one epoll set
+#define POLL_MAX NOFILE
+#define EPOLL_MAX NOFILE
+
+// epoll_ctl ops
+#define EPOLL_CTL_ADD 1
+#define EPOLL_CTL_DEL 2
+#define EPOLL_CTL_MOD 3
+
+struct pollfd {
+  int fd;
+  short events;  // POLL* wanted
+  short revents; // POLL* that happened, filled by poll()
+};
+
+struct epoll_event {
+  uint32_t events; // EPOLL* wanted (ctl) / that happened (wait)
+  uint32_t pad;
+  uint64_t data;   // returned with the event
+};
+
+struct WaitQueue;
+
+// how a file's poll op registers the waiter: qproc is called with each queue that is
+// woken when the file's readiness may have changed
+typedef struct poll_table {
+  void (*qproc)(struct poll_table *pt, struct WaitQueue *wq);
+} poll_table;
+
+static inline void poll_wait(poll_table *pt, struct WaitQueue *wq) {
+  if (pt && wq)
+    pt->qproc(pt, wq);
+}
+
+// readiness of f; files without a poll op (disk files) are always readable/writable
+uint32_t file_poll(struct file *f, poll_table *pt);
+
+struct ProcessControlBlock;
+
+// poll: fill revents of nfds entries; timeout in mtime ticks (0 = just look, < 0 =
+// no limit). Returns the number of entries with revents set, or -1
+int64_t fd_poll(struct ProcessControlBlock *p, struct pollfd *fds, int nfds, int64_t timeout);
+// epoll: the set is an open file, so it is shared and closed like any other fd
+int64_t epoll_create(struct ProcessControlBlock *p);
+int64_t epoll_ctl(struct ProcessControlBlock *p, int epfd, int op, int fd,
+                  const struct epoll_event *ev);
+// wait for up to max events of the set (level triggered); timeout as for poll
+int64_t epoll_wait(struct ProcessControlBlock *p, int epfd, struct epoll_event *evs, int max,
+                   int64_t timeout);
+
+#endif /* _POLL_H_ */
@@ -15,6 +15,29 @@
 
 #define MSTATUS_SIE (1UL << 3)
 
+/* mstatus.FS: floating-point unit state (off / initial / clean / dirty) */
+#define MSTATUS_FS (3UL << 13)
+#define MSTATUS_FS_OFF (0UL << 13)
+#define MSTATUS_FS_INITIAL (1UL << 13)
+#define MSTATUS_FS_CLEAN (2UL << 13)
+#define MSTATUS_FS_DIRTY (3UL << 13)
+
+/* CLINT (QEMU virt) machine timer */
+#define CLINT_BASE 0x02000000UL
+#define CLINT_MSIP(hartid) (CLINT_BASE + 4 * (hartid))
+#define CLINT_MTIME (CLINT_BASE + 0xBFF8)
+#define CLINT_MTIMECMP(hartid) (CLINT_BASE + 0x4000 + 8 * (hartid))
+#define MTIME_FREQ 10000000ULL // timebase-frequency of QEMU virt (Hz)
+
+static inline uint64_t read_mtime(void) { return *(volatile uint64_t *)CLINT_MTIME; }
+
+/* cycle counter, for fine-grained latency measurements */
+static inline uint64_t read_mcycle(void) {
+  uint64_t x;
+  asm volatile("csrr %0, mcycle" : "=r"(x));
+  return x;
+}
+
 static inline uint64_t csrr_mstatus() {
   uint64_t x;
   asm volatile("csrr %0, mstatus" : "=r"(x));
@@ -32,4 +55,16 @@ static inline void intr_off() {
   unsigned long x = 1UL << 3; // MIE bit
   asm volatile("csrc mstatus, %0" ::"r"(x));
 }
+
+/* disable interrupts, returning whether they were on (for intr_restore) */
+static inline int intr_save() {
+  int on = (csrr_mstatus() & MSTATUS_SIE) != 0;
+  intr_off();
+  return on;
+}
+
+static inline void intr_restore(int on) {
+  if (on)
+    intr_on();
+}
 #endif /* _RISCV_H_ */
@@ -24,6 +24,9 @@
 #define va_arg __builtin_va_arg
 
 // RISC-V64 register context(the registers need to save)
+// Used both as the trap frame saved by trapentry.S (all fields) and as the kernel
+// context saved by switch_context (ra, s0-s11, sp only); the offsets are shared
+// with both assembly files.
 typedef struct RegisterState {
   uint64_t x1;      // ra - return address
   uint64_t x5;      // t0
@@ -56,6 +59,13 @@ typedef struct RegisterState {
   uint64_t sepc;    // exception return address
   uint64_t sp;      // stack pointer
   uint64_t mstatus; // mstatus
+  uint64_t kscratch; // mscratch on trap return: kernel stack top, 0 = back to kernel code
 } RegState;
 
+// floating-point context (f0-f31 + fcsr), saved lazily on context switch
+typedef struct FloatState {
+  uint64_t f[32]; // f0..f31 (raw 64-bit contents)
+  uint64_t fcsr;  // fflags + frm
+} FPState;
+
 #endif
@@ -142,6 +142,72 @@ void kfree(void *addr) {
   mm.free_pages++;
 }
 
+/**
+ * Take pages [first, first + n) off the free list and mark them used;
+ * all of them must be free
+ */
+static void *take_pages(uint32_t first, uint32_t n) {
+  Page **pp = &mm.free_list;
+  while (*pp) {
+    uint32_t idx = *pp - mm.page_array;
+    if (idx >= first && idx < first + n) {
+      Page *page = *pp;
+      *pp = page->next;
+      page->flags = PAGE_USED;
+      page->next = NULL;
+    } else {
+      pp = &(*pp)->next;
+    }
+  }
+  mm.free_pages -= n;
+
+  uint8_t *addr = (uint8_t *)mm.memory_start + (size_t)first * PAGE_SIZE;
+  for (size_t i = 0; i < (size_t)n * PAGE_SIZE; i++)
+    addr[i] = 0;
+  return addr;
+}
+
+/**
+ * Allocate n contiguous pages: first fit over the page descriptors
+ */
+void *kalloc_pages(uint32_t n) {
+  if (n == 0 || n > mm.free_pages)
+    return NULL;
+  uint32_t run = 0;
+  for (uint32_t i = 0; i < mm.total_pages; i++) {
+    run = mm.page_array[i].flags == PAGE_FREE ? run + 1 : 0;
+    if (run == n)
+      return take_pages(i + 1 - n, n);
+  }
+  return NULL;
+}
+
+/**
+ * Allocate the n pages at addr
+ */
+void *kalloc_pages_at(void *addr, uint32_t n) {
+  if (n == 0 || addr < mm.memory_start)
+    return NULL;
+  size_t offset = (uint8_t *)addr - (uint8_t *)mm.memory_start;
+  if (offset % PAGE_SIZE != 0)
+    return NULL;
+  uint32_t first = offset / PAGE_SIZE;
+  if (first >= mm.total_pages || n > mm.total_pages - first)
+    return NULL;
+  for (uint32_t i = first; i < first + n; i++)
+    if (mm.page_array[i].flags != PAGE_FREE)
+      return NULL;
+  return take_pages(first, n);
+}
+
+/**
+ * Free n contiguous pages
+ */
+void kfree_pages(void *addr, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++)
+    kfree((uint8_t *)addr + (size_t)i * PAGE_SIZE);
+}
+
 /**
  * Get total number of pages
  */
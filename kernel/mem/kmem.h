@@ -61,6 +61,28 @@ void *kalloc(void);
  */
 void kfree(void *addr);
 
+/**
+ * Allocate n physically contiguous pages (zeroed)
+ * @param n Number of pages
+ * @return Address of the first page, NULL if no free run of n pages exists
+ */
+void *kalloc_pages(uint32_t n);
+
+/**
+ * Allocate the n pages starting at a given address (zeroed)
+ * @param addr Page-aligned address inside the heap
+ * @param n Number of pages
+ * @return addr, or NULL if any of the pages is in use or outside the heap
+ */
+void *kalloc_pages_at(void *addr, uint32_t n);
+
+/**
+ * Free n contiguous pages from kalloc_pages/kalloc_pages_at
+ * @param addr Address of the first page
+ * @param n Number of pages
+ */
+void kfree_pages(void *addr, uint32_t n);
+
 /**
  * Get the total number of memory pages
  * @return Total number of pages
@@ -0,0 +1,91 @@
+/*
+ * Lrix
+ * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+ *
+ * This program is released under the terms of the GNU General Public License version 2(GPLv2).
+ * See https://opensource.org/licenses/GPL-2.0 for more information.
+ *
+ * Project homepage: https://github.com/lrisguan/Lrix
+ * Description: A scratch implemention of OS based on RISC-V
+ */
+
+// elf.h - the parts of the ELF64 format the program loader reads
+
+#ifndef _ELF_H_
+#define _ELF_H_
+
+#include <stdint.h>
+
+#define ELF_MAGIC 0x464C457FU // "\x7FELF", little endian
+
+// e_ident[]
+#define EI_CLASS 4
+#define EI_DATA 5
+#define ELFCLASS64 2
+#define ELFDATA2LSB 1
+
+// e_type
+#define ET_EXEC 2 // linked at a fixed address
+#define ET_DYN 3  // position independent (static-pie)
+
+#define EM_RISCV 243
+
+typedef struct {
+  uint8_t e_ident[16];
+  uint16_t e_type;
+  uint16_t e_machine;
+  uint32_t e_version;
+  uint64_t e_entry;
+  uint64_t e_phoff;
+  uint64_t e_shoff;
+  uint32_t e_flags;
+  uint16_t e_ehsize;
+  uint16_t e_phentsize;
+  uint16_t e_phnum;
+  uint16_t e_shentsize;
+  uint16_t e_shnum;
+  uint16_t e_shstrndx;
+} Elf64_Ehdr;
+
+// p_type
+#define PT_LOAD 1
+#define PT_DYNAMIC 2
+
+// p_flags
+#define PF_X 0x1
+#define PF_W 0x2
+#define PF_R 0x4
+
+typedef struct {
+  uint32_t p_type;
+  uint32_t p_flags;
+  uint64_t p_offset;
+  uint64_t p_vaddr;
+  uint64_t p_paddr;
+  uint64_t p_filesz;
+  uint64_t p_memsz;
+  uint64_t p_align;
+} Elf64_Phdr;
+
+// d_tag
+#define DT_NULL 0
+#define DT_RELA 7
+#define DT_RELASZ 8
+#define DT_RELAENT 9
+
+typedef struct {
+  int64_t d_tag;
+  uint64_t d_val;
+} Elf64_Dyn;
+
+#define ELF64_R_TYPE(info) ((uint32_t)(info))
+#define R_RISCV_NONE 0
+#define R_RISCV_RELATIVE 3
+
+typedef struct {
+  uint64_t r_offset;
+  uint64_t r_info;
+  int64_t r_addend;
+} Elf64_Rela;
+
+#endif /* _ELF_H_ */
@@ -0,0 +1,281 @@
+/*
+ * Lrix
+ * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+ *
+ * This program is released under the terms of the GNU General Public License version 2(GPLv2).
+ * See https://opensource.org/licenses/GPL-2.0 for more information.
+ *
+ * Project homepage: https://github.com/lrisguan/Lrix
+ * Description: A scratch implemention of OS based on RISC-V
+ */
+
+// exec.c - linked-in program table and the ELF64 loader
+//
+// Called from syscalls with interrupts off, but loading a file sleeps on the disk, so
+// another exec may run in the middle of it. A slot is claimed (inum set, one reference)
+// before its load starts and only becomes shared once it is complete.
+
+#include "exec.h"
+#include "../fs/file.h"
+#include "../mem/kmem.h"
+#include "../string/string.h"
+#include "elf.h"
+
+// ==== programs linked into the kernel image ====
+
+typedef void (*exec_entry_fn)(int, char **);
+
+typedef struct ExecEntry {
+  const char *name;
+  exec_entry_fn entry;
+} ExecEntry;
+
+// declare user-space entry functions that are linked into the kernel image
+extern void user_shell(void);
+extern void hello_main(int argc, char **argv);
+
+static ExecEntry exec_table[] = {
+    {"sh", (exec_entry_fn)user_shell},
+    {"hello", hello_main},
+};
+
+static int exec_table_count = sizeof(exec_table) / sizeof(exec_table[0]);
+
+// simple strcmp implementation (to avoid depending on kernel string.h symbols here)
+static int kstrcmp(const char *a, const char *b) {
+  while (*a && *a == *b) {
+    a++;
+    b++;
+  }
+  return (int)(unsigned char)*a - (int)(unsigned char)*b;
+}
+
+// look up program name in exec_table and return entry address, or -1
+static uint64_t exec_lookup_name(const char *name) {
+  for (int i = 0; i < exec_table_count; i++) {
+    if (kstrcmp(exec_table[i].name, name) == 0) {
+      return (uint64_t)exec_table[i].entry;
+    }
+  }
+  return (uint64_t)-1;
+}
+
+// ==== ELF images ====
+
+static struct exec_image images[NIMAGE];
+
+struct exec_image *image_dup(struct exec_image *img) {
+  if (img)
+    img->ref++;
+  return img;
+}
+
+static void image_free(struct exec_image *img) {
+  kfree_pages(img->base, img->npages);
+  memset(img, 0, sizeof(*img));
+}
+
+void image_put(struct exec_image *img) {
+  if (!img || img->ref <= 0)
+    return;
+  // a shared image stays loaded for the next exec of its file (until evicted)
+  if (--img->ref == 0 && !img->shared)
+    image_free(img);
+}
+
+// drop every cached image nobody runs; returns how many
+static int image_trim(void) {
+  int n = 0;
+  for (int i = 0; i < NIMAGE; i++) {
+    if (images[i].inum && images[i].ref == 0) {
+      image_free(&images[i]);
+      n++;
+    }
+  }
+  return n;
+}
+
+// a free slot, evicting a cached image if needed
+static struct exec_image *image_slot(void) {
+  for (int i = 0; i < NIMAGE; i++)
+    if (!images[i].inum)
+      return &images[i];
+  for (int i = 0; i < NIMAGE; i++) {
+    if (images[i].ref == 0) {
+      image_free(&images[i]);
+      return &images[i];
+    }
+  }
+  return NULL;
+}
+
+static int elf_read(struct file *f, void *dst, uint64_t len, uint64_t off) {
+  struct iovec v = {dst, len};
+  return file_read(f, &v, 1, (int64_t)off) == (int64_t)len ? 0 : -1;
+}
+
+/* apply the DT_RELA table of a static-pie image loaded bias bytes above its link
+ * addresses; [lo, hi) is the linked range. Only R_RISCV_RELATIVE is possible without a
+ * dynamic linker, anything else means the binary is not static
+ */
+static int elf_relocate(uint64_t bias, uint64_t lo, uint64_t hi, const Elf64_Phdr *dyn) {
+  if (dyn->p_vaddr < lo || dyn->p_vaddr + dyn->p_memsz > hi)
+    return -1;
+  uint64_t rela = 0, relasz = 0, relaent = sizeof(Elf64_Rela);
+  const Elf64_Dyn *d = (const Elf64_Dyn *)(bias + dyn->p_vaddr);
+  for (uint64_t i = 0; i < dyn->p_memsz / sizeof(Elf64_Dyn) && d[i].d_tag != DT_NULL; i++) {
+    if (d[i].d_tag == DT_RELA)
+      rela = d[i].d_val;
+    else if (d[i].d_tag == DT_RELASZ)
+      relasz = d[i].d_val;
+    else if (d[i].d_tag == DT_RELAENT)
+      relaent = d[i].d_val;
+  }
+  if (relasz == 0)
+    return 0;
+  if (relaent != sizeof(Elf64_Rela) || rela < lo || rela + relasz > hi)
+    return -1;
+
+  for (uint64_t off = 0; off < relasz; off += relaent) {
+    Elf64_Rela r;
+    memcpy(&r, (void *)(bias + rela + off), sizeof(r));
+    uint32_t type = ELF64_R_TYPE(r.r_info);
+    if (type == R_RISCV_NONE)
+      continue;
+    if (type != R_RISCV_RELATIVE || r.r_offset < lo || r.r_offset + sizeof(uint64_t) > hi)
+      return -1;
+    uint64_t val = bias + (uint64_t)r.r_addend;
+    memcpy((void *)(bias + r.r_offset), &val, sizeof(val)); // may be unaligned
+  }
+  return 0;
+}
+
+// load the ELF file f into img (base, npages, entry, shared); sleeps on the disk
+static int elf_load(struct file *f, struct exec_image *img) {
+  Elf64_Ehdr eh;
+  Elf64_Phdr ph[ELF_MAXPHDR];
+  if (elf_read(f, &eh, sizeof(eh), 0) < 0)
+    return -1;
+  uint32_t magic;
+  memcpy(&magic, eh.e_ident, sizeof(magic));
+  if (magic != ELF_MAGIC || eh.e_ident[EI_CLASS] != ELFCLASS64 ||
+      eh.e_ident[EI_DATA] != ELFDATA2LSB || eh.e_machine != EM_RISCV ||
+      (eh.e_type != ET_EXEC && eh.e_type != ET_DYN) || eh.e_phentsize != sizeof(Elf64_Phdr) ||
+      eh.e_phnum == 0 || eh.e_phnum > ELF_MAXPHDR)
+    return -1;
+  if (elf_read(f, ph, eh.e_phnum * sizeof(Elf64_Phdr), eh.e_phoff) < 0)
+    return -1;
+
+  // extent of the PT_LOAD segments
+  uint64_t lo = (uint64_t)-1, hi = 0;
+  int writable = 0;
+  const Elf64_Phdr *dyn = NULL;
+  for (int i = 0; i < eh.e_phnum; i++) {
+    if (ph[i].p_type == PT_DYNAMIC)
+      dyn = &ph[i];
+    if (ph[i].p_type != PT_LOAD || ph[i].p_memsz == 0)
+      continue;
+    if (ph[i].p_filesz > ph[i].p_memsz || ph[i].p_vaddr + ph[i].p_memsz < ph[i].p_vaddr)
+      return -1;
+    uint64_t start = ph[i].p_vaddr & ~(uint64_t)(PAGE_SIZE - 1);
+    if (start < lo)
+      lo = start;
+    if (ph[i].p_vaddr + ph[i].p_memsz > hi)
+      hi = ph[i].p_vaddr + ph[i].p_memsz;
+    if (ph[i].p_flags & PF_W)
+      writable = 1;
+  }
+  if (hi <= lo || (hi - lo + PAGE_SIZE - 1) / PAGE_SIZE > EXEC_MAXPAGES)
+    return -1;
+  uint32_t npages = (uint32_t)((hi - lo + PAGE_SIZE - 1) / PAGE_SIZE);
+
+  // static-pie goes wherever there is room, a fixed-address binary only at its address
+  void *base;
+  if (eh.e_type == ET_DYN) {
+    base = kalloc_pages(npages);
+    if (!base && image_trim())
+      base = kalloc_pages(npages);
+  } else {
+    base = kalloc_pages_at((void *)lo, npages);
+    if (!base && image_trim())
+      base = kalloc_pages_at((void *)lo, npages);
+  }
+  if (!base)
+    return -1;
+  uint64_t bias = (uint64_t)base - lo;
+
+  // segments are copied straight from the file; the pages come zeroed, which is the bss
+  for (int i = 0; i < eh.e_phnum; i++) {
+    if (ph[i].p_type != PT_LOAD || ph[i].p_filesz == 0)
+      continue;
+    if (elf_read(f, (void *)(bias + ph[i].p_vaddr), ph[i].p_filesz, ph[i].p_offset) < 0)
+      goto bad;
+  }
+  if (eh.e_type == ET_DYN && dyn && elf_relocate(bias, lo, hi, dyn) < 0)
+    goto bad;
+  if (eh.e_entry < lo || eh.e_entry >= hi)
+    goto bad;
+
+  // the copied code is only fetched after the return to the process
+  asm volatile("fence.i");
+  img->base = base;
+  img->npages = npages;
+  img->entry = bias + eh.e_entry;
+  img->shared = !writable;
+  return 0;
+
+bad:
+  kfree_pages(base, npages);
+  return -1;
+}
+
+int exec_resolve(const char *name, uint64_t *entry, struct exec_image **img) {
+  *img = NULL;
+  if (!name)
+    return -1;
+  *entry = exec_lookup_name(name);
+  if (*entry != (uint64_t)-1)
+    return 0;
+
+  struct file *f = fs_open(name, 0);
+  if (!f)
+    return -1;
+  uint32_t inum = f->inum;
+  uint32_t gen = fs_inode_gen(inum);
+
+  for (int i = 0; i < NIMAGE; i++) {
+    struct exec_image *c = &images[i];
+    if (c->inum != inum)
+      continue;
+    if (c->gen == gen && c->shared) {
+      // the same unchanged file is already in memory: no disk I/O, no second copy
+      file_close(f);
+      *entry = c->entry;
+      *img = image_dup(c);
+      return 0;
+    }
+    if (c->gen != gen && c->ref == 0)
+      image_free(c); // the file changed since
+  }
+
+  // claim the slot before the load sleeps: a referenced, not (yet) shared image is
+  // neither handed out nor evicted by a concurrent exec
+  struct exec_image *slot = image_slot();
+  if (!slot) {
+    file_close(f);
+    return -1;
+  }
+  slot->inum = inum;
+  slot->gen = gen;
+  slot->ref = 1;
+  slot->shared = 0;
+  int r = elf_load(f, slot);
+  file_close(f);
+  if (r < 0) {
+    memset(slot, 0, sizeof(*slot));
+    return -1;
+  }
+  *entry = slot->entry;
+  *img = slot;
+  return 0;
+}
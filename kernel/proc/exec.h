@@ -0,0 +1,51 @@
+/*
+ * Lrix
+ * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+ *
+ * This program is released under the terms of the GNU General Public License version 2(GPLv2).
+ * See https://opensource.org/licenses/GPL-2.0 for more information.
+ *
+ * Project homepage: https://github.com/lrisguan/Lrix
+ * Description: A scratch implemention of OS based on RISC-V
+ */
+
+// exec.h - program images for exec/spawn
+//
+// A program name is looked up first among the programs linked into the kernel (sh,
+// hello), then as a statically linked ELF64 file of the root directory. The file's
+// PT_LOAD segments go into contiguous pages: ET_DYN (static-pie) binaries anywhere,
+// with their R_RISCV_RELATIVE relocations applied, ET_EXEC ones only at their link
+// address. There is no MMU, so code reaching its data pc-relatively cannot share text
+// with per-process data: an image without writable segments is loaded once, shared by
+// every process running it and kept while the file is unchanged; one with writable
+// segments gets its own copy per exec (forked children share it, as they share the
+// linked-in programs' data).
+
+#ifndef _EXEC_H_
+#define _EXEC_H_
+
+#include <stdint.h>
+
+#define NIMAGE 8          // loaded images, cached or running
+#define ELF_MAXPHDR 16    // program headers read per binary
+#define EXEC_MAXPAGES 128 // largest image (the largest file is MAXFILE blocks)
+
+struct exec_image {
+  uint32_t inum;   // file it was loaded from, 0 = free slot
+  uint32_t gen;    // fs_inode_gen() of the file when loaded
+  int ref;         // processes running it; 0 = only cached
+  int shared;      // no writable segment: reused by later execs of the same file
+  void *base;      // first page
+  uint32_t npages;
+  uint64_t entry;
+};
+
+// resolve name to an entry point; *img gets a referenced image for ELF files, NULL
+// for linked-in programs. Returns 0, or -1 if there is no such program or it does not
+// load
+int exec_resolve(const char *name, uint64_t *entry, struct exec_image **img);
+struct exec_image *image_dup(struct exec_image *img);
+// drop a reference; private images are freed with their last one
+void image_put(struct exec_image *img);
+
+#endif /* _EXEC_H_ */
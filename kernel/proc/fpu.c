@@ -0,0 +1,72 @@
+/*
+ * Lrix
+ * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+ *
+ * This program is released under the terms of the GNU General Public License version 2(GPLv2).
+ * See https://opensource.org/licenses/GPL-2.0 for more information.
+ *
+ * Project homepage: https://github.com/lrisguan/Lrix
+ * Description: A scratch implemention of OS based on RISC-V
+ */
+
+
+// fpu.c - lazy FP context: registers are saved only when dirty and restored on first use
+
+#include "fpu.h"
+#include "../include/riscv.h"
+#include "../string/string.h"
+
+// assembly helpers (fpu_asm.S); both require mstatus.FS != off
+extern void fpu_save(FPState *fs);
+extern void fpu_restore(FPState *fs);
+
+// process whose FP state currently lives in f0-f31/fcsr (NULL = nobody)
+static PCB *fpu_owner = NULL;
+
+void fpu_switch(PCB *old, PCB *next) {
+  (void)old;
+  // only the running process can have dirtied the registers, and it can only do
+  // so after fpu_trap() made it the owner
+  if ((csrr_mstatus() & MSTATUS_FS) == MSTATUS_FS_DIRTY && fpu_owner)
+    fpu_save(&fpu_owner->fpstate);
+
+  if (!next)
+    return;
+  // integer-only processes never touch the FP registers: they keep FS off and
+  // pay nothing; the owner may keep using its live registers (clean)
+  // (FS takes effect when trap_return reloads mstatus from next's trap frame)
+  next->tf->mstatus &= ~MSTATUS_FS;
+  if (next == fpu_owner)
+    next->tf->mstatus |= MSTATUS_FS_CLEAN;
+}
+
+int fpu_trap(void) {
+  PCB *cur = get_current_proc();
+  if (!cur || (csrr_mstatus() & MSTATUS_FS) != MSTATUS_FS_OFF)
+    return 0;
+
+  // the previous owner's registers were saved when it was switched out dirty
+  // (or are unchanged since its last save), so they can be overwritten here
+  csrw_mstatus((csrr_mstatus() & ~MSTATUS_FS) | MSTATUS_FS_INITIAL);
+  fpu_restore(&cur->fpstate);
+  csrw_mstatus((csrr_mstatus() & ~MSTATUS_FS) | MSTATUS_FS_CLEAN);
+  // and keep it on when the trap returns (mstatus is restored from the frame)
+  cur->tf->mstatus = (cur->tf->mstatus & ~MSTATUS_FS) | MSTATUS_FS_CLEAN;
+
+  fpu_owner = cur;
+  cur->fp_used = 1;
+  return 1;
+}
+
+void fpu_fork(PCB *parent, PCB *child) {
+  child->fp_used = parent->fp_used;
+  if (parent == fpu_owner && (csrr_mstatus() & MSTATUS_FS) != MSTATUS_FS_OFF)
+    fpu_save(&child->fpstate); // live registers are the parent's newest state
+  else
+    memcpy(&child->fpstate, &parent->fpstate, sizeof(FPState));
+}
+
+void fpu_release(PCB *p) {
+  if (fpu_owner == p)
+    fpu_owner = NULL;
+}
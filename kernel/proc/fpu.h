@@ -0,0 +1,35 @@
+/*
+ * Lrix
+ * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+ *
+ * This program is released under the terms of the GNU General Public License version 2(GPLv2).
+ * See https://opensource.org/licenses/GPL-2.0 for more information.
+ *
+ * Project homepage: https://github.com/lrisguan/Lrix
+ * Description: A scratch implemention of OS based on RISC-V
+ */
+
+
+// fpu.h - lazy floating-point context switching driven by mstatus.FS
+
+#ifndef _FPU_H_
+#define _FPU_H_
+
+#include "proc.h"
+
+// called by schedule() before switching from old to next: saves the live FP
+// registers only if mstatus.FS says they are dirty, and leaves FS off for next
+// unless its state is still in the registers
+void fpu_switch(PCB *old, PCB *next);
+
+// illegal-instruction hook: if the FPU was off, load the current process's FP
+// state and turn it on; returns 1 if handled (the instruction is retried)
+int fpu_trap(void);
+
+// copy parent's FP state into a forked child
+void fpu_fork(PCB *parent, PCB *child);
+
+// forget p as FPU owner before its PCB is freed
+void fpu_release(PCB *p);
+
+#endif /* _FPU_H_ */
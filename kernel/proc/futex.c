@@ -0,0 +1,97 @@
+/*
+ * Lrix
+ * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+ *
+ * This program is released under the terms of the GNU General Public License version 2(GPLv2).
+ * See https://opensource.org/licenses/GPL-2.0 for more information.
+ *
+ * Project homepage: https://github.com/lrisguan/Lrix
+ * Description: A scratch implemention of OS based on RISC-V
+ */
+
+
+// futex.c - futex wait/wake/requeue keyed by the physical address of the futex word
+
+#include "futex.h"
+#include "../include/riscv.h"
+#include "../mem/vmm.h"
+#include "proc.h"
+
+// waiters of all futex words hashing to the same bucket share its queue; each
+// wait entry carries the exact key so wake/requeue only touch matching waiters
+static waitqueue futex_buckets[FUTEX_HASH_SIZE];
+
+// key: physical address of the word, so that different virtual mappings of one
+// word meet in the same bucket (unmapped addresses are identity-mapped)
+static uint64_t futex_key(uint32_t *addr) {
+  void *pa = vmm_translate(addr);
+  return pa ? (uint64_t)(uintptr_t)pa : (uint64_t)(uintptr_t)addr;
+}
+
+static waitqueue *futex_bucket(uint64_t key) {
+  // words are 4-byte aligned: drop the low bits, then fold the page number in
+  uint64_t h = (key >> 2) ^ (key >> 12);
+  return &futex_buckets[h % FUTEX_HASH_SIZE];
+}
+
+static int futex_wait(uint32_t *addr, uint32_t val, uint64_t timeout) {
+  uint64_t key = futex_key(addr);
+  wait_entry we;
+
+  // the value check and the queueing happen with interrupts off, so a waker that
+  // changes *addr and calls FUTEX_WAKE cannot be missed
+  intr_off();
+  if (*(volatile uint32_t *)addr != val) {
+    intr_on();
+    return -1;
+  }
+  wq_add(futex_bucket(key), &we, key);
+  return proc_sleep(timeout ? read_mtime() + timeout : 0);
+}
+
+// wake up to n waiters on key; if 'to' is non-zero, move the remaining ones there
+static int futex_wake(uint64_t key, int n, uint64_t to) {
+  waitqueue *wq = futex_bucket(key);
+  waitqueue *to_wq = to ? futex_bucket(to) : NULL;
+  int woken = 0;
+
+  intr_off();
+  wait_entry *we = wq->head;
+  while (we) {
+    wait_entry *next = we->next;
+    if (we->key == key) {
+      if (woken < n) {
+        PCB *p = we->proc;
+        wq_remove(we);
+        proc_wake(p);
+        woken++;
+      } else if (to_wq) {
+        wq_requeue(we, to_wq, to);
+      } else {
+        break;
+      }
+    }
+    we = next;
+  }
+  intr_on();
+  return woken;
+}
+
+int64_t futex(uint32_t *addr, int op, uint32_t val, uint64_t arg) {
+  if (!addr || ((uintptr_t)addr & 3))
+    return -1;
+  switch (op) {
+  case FUTEX_WAIT:
+    return futex_wait(addr, val, arg);
+  case FUTEX_WAKE:
+    return futex_wake(futex_key(addr), (int)val, 0);
+  case FUTEX_REQUEUE:
+    if (!arg || (arg & 3))
+      return -1;
+    if (futex_key((uint32_t *)arg) == futex_key(addr))
+      return futex_wake(futex_key(addr), (int)val, 0);
+    return futex_wake(futex_key(addr), (int)val, futex_key((uint32_t *)arg));
+  default:
+    return -1;
+  }
+}
@@ -0,0 +1,32 @@
+/*
+ * Lrix
+ * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+ *
+ * This program is released under the terms of the GNU General Public License version 2(GPLv2).
+ * See https://opensource.org/licenses/GPL-2.0 for more information.
+ *
+ * Project homepage: https://github.com/lrisguan/Lrix
+ * Description: A scratch implemention of OS based on RISC-V
+ */
+
+
+// futex.h - kernel wait buckets for user-space synchronization
+
+#ifndef _FUTEX_H_
+#define _FUTEX_H_
+
+#include <stdint.h>
+
+// futex operations
+#define FUTEX_WAIT 0    // sleep if *addr == val (arg = timeout in mtime ticks, 0 = none)
+#define FUTEX_WAKE 1    // wake up to val waiters on addr
+#define FUTEX_REQUEUE 2 // wake up to val waiters, move the rest to addr2 (arg)
+
+// number of hashed wait buckets
+#define FUTEX_HASH_SIZE 64
+
+// futex(addr, op, val, arg): WAIT returns 0 when woken and -1 on timeout or value
+// mismatch; WAKE/REQUEUE return the number of woken waiters
+int64_t futex(uint32_t *addr, int op, uint32_t val, uint64_t arg);
+
+#endif /* _FUTEX_H_ */
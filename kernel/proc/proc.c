@@ -15,8 +15,16 @@
 #include "../include/log.h"
 #include "../include/riscv.h"
 #include "../mem/kmem.h"
+#include "../fs/file.h"
 #include "../mem/vmm.h"
 #include "../string/string.h"
+#include "../syscall/syscall.h"
+#include "../syscall/uring.h"
+#include "exec.h"
+#include "fpu.h"
+#include "sched.h"
+#include "sched_dl.h"
+#include "../trap/trap.h"
 
 // User heap layout (must match syscall.c)
 #define HEAP_USER_BASE 0x80400000UL
@@ -25,6 +33,7 @@
 // extern assembly context switch
 extern void switch_context(RegState *old, RegState *new);
 extern void forkret(void);
+extern void thread_exit_stub(void);
 
 // globals
 PCB *idle_proc = NULL; // global Idle process pointer
@@ -38,6 +47,33 @@ PCB *blocked_list = NULL; // processes blocked waiting (e.g., wait())
 static int next_pid = 1;
 static RegState boot_ctx; // temporary context for boot / first switch
 
+// allocate p's kernel stack and build the trap frame its first run returns
+// through: switch_context 'returns' into forkret with sp at the frame, and
+// trap_return starts the process at entry on stack sp with interrupts enabled
+static int proc_kstack_init(PCB *p, uint64_t entry, uint64_t sp) {
+  void *kstk = kalloc();
+  if (!kstk)
+    return -1;
+  p->kstacktop = (uint64_t)kstk + PAGE_SIZE;
+  p->tf = (RegState *)(p->kstacktop - sizeof(RegState));
+  memset(p->tf, 0, sizeof(RegState));
+  p->tf->sepc = entry;
+  p->tf->sp = sp;
+  p->tf->mstatus = (3ULL << 11) | (1ULL << 7); // MPP = Machine Mode, MPIE = 1
+  p->tf->kscratch = p->kstacktop;
+
+  memset(&p->regstat, 0, sizeof(RegState));
+  p->regstat.x1 = (uint64_t)forkret;
+  p->regstat.sp = (uint64_t)p->tf;
+  return 0;
+}
+
+// free a process's stack page and kernel stack page
+static void proc_free_stacks(PCB *p) {
+  kfree((void *)(p->stacktop - PAGE_SIZE));
+  kfree((void *)(p->kstacktop - PAGE_SIZE));
+}
+
 // internal helper: free one PCB's resources (stack + user heap + PCB itself)
 // Note: Do not call it on the currently running process,
 //       otherwise it is equivalent to performing kfree on a stack that is in use.
@@ -48,8 +84,7 @@ static void free_pcb_resources(PCB *p) {
   int pid = p->pid;
 
   printk(BLUE "[proc]: \tShutdown cleanup pid=%d: free stack" RESET "\n", pid);
-  void *stk = (void *)(p->stacktop - PAGE_SIZE);
-  kfree(stk);
+  proc_free_stacks(p);
 
   if (p->brk_base && p->brk_size > 0) {
     printk(BLUE "[proc]: \tShutdown cleanup pid=%d: free heap (size=%llu)" RESET "\n", pid,
@@ -62,6 +97,12 @@ static void free_pcb_resources(PCB *p) {
   }
 
   printk(BLUE "[proc]: \tShutdown cleanup pid=%d: free PCB" RESET "\n", pid);
+  fpu_release(p);
+  dl_release(p);
+  strace_release(p);
+  uring_release(p);
+  fd_release_all(p);
+  image_put(p->image);
   kfree(p);
 }
 
@@ -147,19 +188,15 @@ PCB *proc_create(const char *name, uint64_t entrypoint, int prior) {
   }
   pcb->stacktop = (uint64_t)stk + PAGE_SIZE;
 
-  // initialize register state: set sepc/mepc to entrypoint and sp
-  memset(&pcb->regstat, 0, sizeof(RegState));
-
-  pcb->regstat.x1 = (uint64_t)forkret; // set return address to forkret
-  pcb->regstat.sepc = entrypoint;      // switch_context will load it to mepc
-  pcb->regstat.sp = pcb->stacktop;
-
-  uint64_t mstatus_val = 0;
-  mstatus_val |= (3ULL << 11); // Set MPP to Machine Mode
-  mstatus_val |= (1ULL << 7);  // Set MPIE to 1
-  pcb->regstat.mstatus = mstatus_val;
+  // kernel stack + initial trap frame: start at entrypoint on the stack above
+  if (proc_kstack_init(pcb, entrypoint, pcb->stacktop) < 0) {
+    kfree(stk);
+    kfree(pcb);
+    return NULL;
+  }
 
-  enqueue(ready_queue, pcb);
+  fd_init_console(pcb);
+  proc_ready(pcb);
 
   return pcb;
 }
@@ -191,19 +228,10 @@ void scheduler_init(void) {
         ;
     idle_proc->stacktop = (uint64_t)stk + PAGE_SIZE;
 
-    // initialize context
-    memset(&idle_proc->regstat, 0, sizeof(RegState));
-    // return address
-    idle_proc->regstat.x1 = (uint64_t)forkret;
-    // entry
-    idle_proc->regstat.sepc = (uint64_t)idle_entry;
-    idle_proc->regstat.sp = idle_proc->stacktop;
-
-    // initialize mstatus (Machine Mode, MPIE=1)
-    uint64_t mstatus_val = 0;
-    mstatus_val |= (3ULL << 11);
-    mstatus_val |= (1ULL << 7);
-    idle_proc->regstat.mstatus = mstatus_val;
+    // initialize context: enter idle_entry (Machine Mode, MPIE=1)
+    if (proc_kstack_init(idle_proc, (uint64_t)idle_entry, idle_proc->stacktop) < 0)
+      while (1)
+        ;
 
     INFO("Scheduler & Idle process initialized.");
   }
@@ -240,8 +268,8 @@ PCB *proc_fork(uint64_t mepc) {
     child->name[i] = parent->name[i];
   child->name[19] = '\0';
 
-  /* copy regstat */
-  child->regstat = parent->regstat;
+  /* inherit FP registers (possibly still live in the FPU) */
+  fpu_fork(parent, child);
 
   /* allocate stack for child and copy parent's stack content */
   void *stk = kalloc();
@@ -250,6 +278,18 @@ PCB *proc_fork(uint64_t mepc) {
     intr_on();
     return NULL;
   }
+  /* kernel stack; its trap frame becomes a copy of the parent's (user registers
+   * at the fork ecall)
+   */
+  if (proc_kstack_init(child, 0, 0) < 0) {
+    kfree(stk);
+    kfree(child);
+    intr_on();
+    return NULL;
+  }
+  *child->tf = *parent->tf;
+  child->tf->kscratch = child->kstacktop;
+
   void *parent_stk_base = (void *)(parent->stacktop - PAGE_SIZE);
   /* copy whole page */
   uint8_t *ps = (uint8_t *)parent_stk_base;
@@ -260,17 +300,14 @@ PCB *proc_fork(uint64_t mepc) {
   child->stacktop = (uint64_t)stk + PAGE_SIZE;
 
   /* adjust child's sp relative to new stack */
-  uint64_t sp_offset = parent->stacktop - child->regstat.sp;
-  child->regstat.sp = child->stacktop - sp_offset;
+  uint64_t sp_offset = parent->stacktop - child->tf->sp;
+  child->tf->sp = child->stacktop - sp_offset;
 
   /* child should return 0 from fork */
-  child->regstat.x10 = 0; /* a0 = 0 in child */
+  child->tf->x10 = 0; /* a0 = 0 in child */
 
   /* set child's sepc to return after ecall (mepc + 4) */
-  child->regstat.sepc = mepc + 4;
-
-  /* set mstatus similar to parent */
-  child->regstat.mstatus = parent->regstat.mstatus;
+  child->tf->sepc = mepc + 4;
 
   /* Inherit parent relationship and deep-copy user heap so that
    * parent/child observe the same user-space state right after fork.
@@ -279,6 +316,9 @@ PCB *proc_fork(uint64_t mepc) {
    */
   child->ppid = parent->pid;
 
+  /* a thread forks the heap of its group */
+  parent = proc_group_leader(parent);
+
   if (parent->brk_base && parent->brk_size > 0) {
     /* Child gets its own per-pid heap region. */
     child->brk_base = (void *)(HEAP_USER_BASE + (uint64_t)child->pid * PER_PROC_HEAP);
@@ -297,9 +337,8 @@ PCB *proc_fork(uint64_t mepc) {
           vmm_unmap(rollback_vaddr, 1);
         }
 
-        /* Free child's kernel stack and PCB, then fail fork. */
-        void *child_stk_base = (void *)(child->stacktop - PAGE_SIZE);
-        kfree(child_stk_base);
+        /* Free child's stacks and PCB, then fail fork. */
+        proc_free_stacks(child);
         kfree(child);
         intr_on();
         return NULL;
@@ -313,21 +352,446 @@ PCB *proc_fork(uint64_t mepc) {
     child->brk_size = 0;
   }
 
-  /* enqueue child */
-  enqueue(ready_queue, child);
+  /* share the group's open files, offsets included, and the program it runs */
+  fd_copy(child, parent, 0);
+  child->image = image_dup(parent->image);
+
+  /* enqueue child (deadline parameters are not inherited) */
+  proc_ready(child);
+
+  intr_on();
+  return child;
+}
+
+// maximum bytes of argv (strings + pointer array) copied onto a new program's stack
+#define SPAWN_ARG_MAX 512
+#define SPAWN_MAXARG 16
+
+/* argv of a new program, gathered in the kernel first: exec rebuilds the very stack
+ * the caller's strings may live on
+ */
+struct proc_args {
+  int argc;
+  uint32_t len;               // bytes of strings in buf
+  uint32_t off[SPAWN_MAXARG]; // start of each string in buf
+  char buf[SPAWN_ARG_MAX];
+};
+
+static int args_collect(struct proc_args *a, char *const argv[]) {
+  a->argc = 0;
+  a->len = 0;
+  uint64_t bytes = 0;
+  for (; argv && argv[a->argc]; a->argc++) {
+    if (a->argc >= SPAWN_MAXARG)
+      return -1;
+    size_t len = strlen(argv[a->argc]) + 1;
+    bytes += len + sizeof(char *);
+    if (bytes + sizeof(char *) > SPAWN_ARG_MAX)
+      return -1;
+    a->off[a->argc] = a->len;
+    memcpy(a->buf + a->len, argv[a->argc], len);
+    a->len += (uint32_t)len;
+  }
+  return 0;
+}
+
+/* put the strings at the top of p's stack and below them the start-up vector of the
+ * ELF ABI: argc, argv[], NULL, an empty envp (NULL) and auxv (AT_NULL). The program
+ * gets a0 = argc, a1 = argv as well, as the linked-in programs take them
+ */
+static void args_push(PCB *p, const struct proc_args *a) {
+  uint64_t sp = p->stacktop - a->len;
+  memcpy((void *)sp, a->buf, a->len);
+  uint64_t strs = sp;
+
+  int words = a->argc + 5;
+  sp -= (uint64_t)words * sizeof(uint64_t);
+  sp &= ~0xFUL; /* keep the ABI's 16-byte stack alignment */
+  uint64_t *v = (uint64_t *)sp;
+  memset(v, 0, (size_t)words * sizeof(uint64_t));
+  v[0] = (uint64_t)a->argc;
+  for (int i = 0; i < a->argc; i++)
+    v[1 + i] = strs + a->off[i];
+
+  p->tf->sp = sp;
+  p->tf->x10 = (uint64_t)a->argc;     /* a0 = argc */
+  p->tf->x11 = sp + sizeof(uint64_t); /* a1 = argv */
+}
+
+/* spawn file action: make f (an open file of the parent) the child's fd */
+static void spawn_set_fd(PCB *child, int fd, struct file *f) {
+  if (!f)
+    return;
+  file_close(child->ofile[fd]);
+  child->ofile[fd] = file_dup(f);
+  child->fd_flags[fd] = 0;
+}
+
+/* Spawn: build a fresh process straight from an entry point.
+ * Unlike proc_fork() nothing of the parent (stack page, heap) is copied, so the
+ * cost is independent of the parent's size. The argv strings are placed at the
+ * top of the child's new stack, followed by the start-up vector (args_push).
+ */
+PCB *proc_spawn(const char *name, uint64_t entrypoint, struct exec_image *img,
+                char *const argv[], int in_fd, int out_fd) {
+  intr_off();
+  PCB *parent = current_proc;
+
+  /* gather argv first so that a too-large request fails before allocating */
+  struct proc_args args;
+  if (args_collect(&args, argv) < 0) {
+    intr_on();
+    return NULL;
+  }
+
+  PCB *child = proc_create(name, entrypoint, parent ? parent->prior : 0);
+  if (!child) {
+    intr_on();
+    return NULL;
+  }
+  child->ppid = parent ? parent->pid : 0;
+  child->image = img;
+  fd_copy(child, parent, 1);
+  spawn_set_fd(child, 0, fd_get(parent, in_fd));
+  spawn_set_fd(child, 1, fd_get(parent, out_fd));
+  args_push(child, &args);
 
   intr_on();
   return child;
 }
 
+static void kill_group_threads(PCB *leader);
+static int group_has_thread(PCB *leader, int tid);
+
+int proc_exec(const char *name, uint64_t entrypoint, struct exec_image *img, char *const argv[]) {
+  PCB *p = current_proc;
+  struct proc_args args;
+  if (!p || p->group_leader || args_collect(&args, argv) < 0)
+    return -1;
+  /* threads run the old program (and use its heap): they go first, as in proc_exit.
+   * One in the middle of a filesystem operation cannot be stopped yet, so then the
+   * exec fails */
+  intr_off();
+  kill_group_threads(p);
+  if (group_has_thread(p, 0))
+    return -1;
+
+  int i;
+  for (i = 0; i < 19 && name && name[i]; i++)
+    p->name[i] = name[i];
+  p->name[i] = '\0';
+  /* the old program's code is never returned to */
+  image_put(p->image);
+  fd_close_on_exec(p);
+  p->image = img;
+  p->entrypoint = entrypoint;
+  p->tf->sepc = entrypoint;
+  args_push(p, &args);
+  return 0;
+}
+
+PCB *proc_group_leader(PCB *p) {
+  if (p && p->group_leader)
+    return p->group_leader;
+  return p;
+}
+
+/* Threads are full scheduling entities (own PCB, stack and kernel stack pages)
+ * that point at their group leader instead of owning a heap. The start routine
+ * returns into thread_exit_stub, which issues SYS_THREAD_EXIT.
+ */
+PCB *proc_thread_create(uint64_t fn, uint64_t arg, uint64_t ustack) {
+  intr_off();
+  PCB *parent = current_proc;
+  if (!parent || parent == idle_proc || !fn) {
+    intr_on();
+    return NULL;
+  }
+  PCB *leader = proc_group_leader(parent);
+
+  PCB *t = proc_create(leader->name, fn, parent->prior);
+  if (!t) {
+    intr_on();
+    return NULL;
+  }
+  t->ppid = parent->pid;
+  t->group_leader = leader;
+  fd_release_all(t); /* it uses the leader's table */
+
+  t->tf->x1 = (uint64_t)thread_exit_stub;
+  t->tf->x10 = arg; /* a0 = arg */
+  if (ustack)
+    t->tf->sp = ustack & ~0xFUL;
+
+  intr_on();
+  return t;
+}
+
+// return 1 if a live (ready/blocked/running) thread with this tid (0: any) exists in
+// the group
+static int group_has_thread(PCB *leader, int tid) {
+  if (current_proc && (!tid || current_proc->pid == tid) && current_proc->group_leader == leader)
+    return 1;
+  for (PCB *p = ready_queue ? ready_queue->head : NULL; p; p = p->next)
+    if ((!tid || p->pid == tid) && p->group_leader == leader)
+      return 1;
+  for (PCB *p = blocked_list; p; p = p->next)
+    if ((!tid || p->pid == tid) && p->group_leader == leader)
+      return 1;
+  return 0;
+}
+
+int proc_thread_join(int tid, uint64_t *retval) {
+  if (!current_proc || current_proc->pid == tid)
+    return -1;
+
+  while (1) {
+    intr_off();
+    PCB *leader = proc_group_leader(current_proc);
+    PCB *prev = NULL;
+    PCB *cur = zombie_list;
+    while (cur) {
+      if (cur->pid == tid && cur->group_leader == leader) {
+        if (prev)
+          prev->next = cur->next;
+        else
+          zombie_list = cur->next;
+
+        if (retval)
+          *retval = cur->exit_val;
+
+        /* threads own only their stack page; the heap belongs to the leader */
+        printk(BLUE "[proc]: \tReaping thread tid=%d: free stack" RESET "\n", tid);
+        proc_free_stacks(cur);
+        kfree(cur);
+
+        if (tid == next_pid - 1 && next_pid > 1)
+          next_pid--;
+
+        current_proc->join_tid = 0;
+        intr_on();
+        return tid;
+      }
+      prev = cur;
+      cur = cur->next;
+    }
+
+    if (!group_has_thread(leader, tid)) {
+      current_proc->join_tid = 0;
+      intr_on();
+      return -1;
+    }
+
+    /* block until the thread exits; proc_exit wakes joiners by join_tid */
+    current_proc->join_tid = tid;
+    current_proc->pstat = BLOCKED;
+    current_proc->next = blocked_list;
+    blocked_list = current_proc;
+    schedule();
+  }
+}
+
+// ==== wait queues ====
+
+// link we at the tail of wq so that sleepers are woken in FIFO order
+static void wq_link(waitqueue *wq, wait_entry *we) {
+  wait_entry **pp = &wq->head;
+  while (*pp)
+    pp = &(*pp)->next;
+  we->wq = wq;
+  we->next = NULL;
+  *pp = we;
+}
+
+void wq_add(waitqueue *wq, wait_entry *we, uint64_t key) {
+  PCB *p = current_proc;
+  we->proc = p;
+  we->key = key;
+  we->func = NULL;
+  wq_link(wq, we);
+  we->pnext = p->waits;
+  p->waits = we;
+}
+
+void wq_add_func(waitqueue *wq, wait_entry *we, void (*func)(wait_entry *we)) {
+  we->proc = NULL;
+  we->key = 0;
+  we->func = func;
+  we->pnext = NULL;
+  wq_link(wq, we);
+}
+
+void wq_requeue(wait_entry *we, waitqueue *to, uint64_t key) {
+  wq_remove(we);
+  we->key = key;
+  wq_link(to, we);
+}
+
+void wq_remove(wait_entry *we) {
+  if (!we->wq)
+    return;
+  wait_entry **pp = &we->wq->head;
+  while (*pp) {
+    if (*pp == we) {
+      *pp = we->next;
+      break;
+    }
+    pp = &(*pp)->next;
+  }
+  we->wq = NULL;
+  we->next = NULL;
+}
+
+// drop every wait queue registration of p
+void wq_remove_all(PCB *p) {
+  wait_entry *we = p->waits;
+  while (we) {
+    wait_entry *next = we->pnext;
+    wq_remove(we);
+    we->pnext = NULL;
+    we = next;
+  }
+  p->waits = NULL;
+}
+
+// unlink p from blocked_list; return 1 if it was there
+static int blocked_remove(PCB *p) {
+  PCB *prev = NULL;
+  for (PCB *cur = blocked_list; cur; prev = cur, cur = cur->next) {
+    if (cur == p) {
+      if (prev)
+        prev->next = cur->next;
+      else
+        blocked_list = cur->next;
+      cur->next = NULL;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int proc_may_sleep(void) {
+  PCB *p = current_proc;
+  return p && p != idle_proc && !p->no_sleep;
+}
+
+void proc_io_begin(void) {
+  if (current_proc)
+    current_proc->in_io++;
+}
+
+void proc_io_end(void) {
+  if (current_proc && current_proc->in_io > 0)
+    current_proc->in_io--;
+}
+
+void proc_wake(PCB *p) {
+  if (!p || p->pstat != BLOCKED)
+    return;
+  wq_remove_all(p);
+  if (!blocked_remove(p))
+    return;
+  p->wake_at = 0;
+  proc_ready(p);
+}
+
+void proc_ready(PCB *p) {
+  int flags = p->pstat == BLOCKED ? ENQ_WAKEUP : 0;
+  p->pstat = READY;
+  sched_enqueue(p, flags);
+}
+
+int proc_sleep(uint64_t deadline) {
+  intr_off();
+  PCB *p = current_proc;
+  if (!p || p == idle_proc) {
+    /* no process context (boot or idle): nothing to block, just drop registrations */
+    if (p)
+      wq_remove_all(p);
+    intr_on();
+    return -1;
+  }
+
+  p->wake_at = deadline;
+  p->pstat = BLOCKED;
+  p->next = blocked_list;
+  blocked_list = p;
+
+  schedule();
+
+  /* proc_wake clears wake_at, the timer tick leaves it set */
+  intr_off();
+  int timed_out = p->wake_at != 0;
+  wq_remove_all(p);
+  p->wake_at = 0;
+  intr_on();
+  return timed_out ? -1 : 0;
+}
+
+int proc_sleep_on(waitqueue *wq, uint64_t deadline) {
+  wait_entry we;
+  intr_off();
+  wq_add(wq, &we, 0);
+  return proc_sleep(deadline);
+}
+
+int proc_wakeup(waitqueue *wq, int n) {
+  int woken = 0;
+  wait_entry **pp = &wq->head;
+  while (*pp && (n < 0 || woken < n)) {
+    wait_entry *we = *pp;
+    if (we->func) {
+      /* callback entries stay queued; proc_wake below never unlinks them, so
+       * pp keeps pointing into the queue */
+      pp = &we->next;
+      we->func(we);
+      continue;
+    }
+    PCB *p = we->proc;
+    wq_remove(we);
+    proc_wake(p);
+    woken++;
+  }
+  return woken;
+}
+
+void proc_timer_tick(void) {
+  uint64_t now = read_mtime();
+  PCB *cur = blocked_list;
+  while (cur) {
+    PCB *next = cur->next;
+    if (cur->wake_at != 0 && now >= cur->wake_at) {
+      /* leave wake_at set so proc_sleep can tell it timed out */
+      blocked_remove(cur);
+      proc_ready(cur);
+    }
+    cur = next;
+  }
+
+  /* charge the running process's time slice (MLFQ demotion, periodic boost) */
+  if (current_proc && current_proc != idle_proc && current_proc->pstat == RUNNING)
+    sched_tick(current_proc);
+}
+
+// ps detail line for deadline tasks
+static void proc_dump_dl(PCB *p) {
+  if (!dl_task(p))
+    return;
+  printk(BLUE "[proc]: \t       deadline runtime=%lu deadline=%lu period=%lu misses=%lu%s" RESET
+              "\n",
+         p->dl_runtime, p->dl_deadline, p->dl_period, p->dl_misses,
+         p->dl_throttled ? " (throttled)" : "");
+}
+
 // dump all processes for debugging / ps syscall
 void proc_dump(void) {
-  printk(BLUE "[proc]: \t==== process list ====" RESET "\n");
+  printk(BLUE "[proc]: \t==== process list (policy %s) ====" RESET "\n", sched_policy_name());
 
   // current running process
   if (current_proc) {
     printk(BLUE "[proc]: \tcurrent pid=%d state=%d name=%s" RESET "\n", current_proc->pid,
            current_proc->pstat, current_proc->name);
+    proc_dump_dl(current_proc);
   }
 
   // idle process
@@ -340,6 +804,7 @@ void proc_dump(void) {
   PCB *p = ready_queue ? ready_queue->head : NULL;
   while (p) {
     printk(BLUE "[proc]: \tready  pid=%d state=%d name=%s" RESET "\n", p->pid, p->pstat, p->name);
+    proc_dump_dl(p);
     p = p->next;
   }
 
@@ -347,6 +812,7 @@ void proc_dump(void) {
   p = blocked_list;
   while (p) {
     printk(BLUE "[proc]: \tblocked pid=%d state=%d name=%s" RESET "\n", p->pid, p->pstat, p->name);
+    proc_dump_dl(p);
     p = p->next;
   }
 
@@ -369,7 +835,7 @@ int proc_wait_and_reap(void) {
     PCB *prev = NULL;
     PCB *cur = zombie_list;
     while (cur) {
-      if (cur->ppid == mypid) {
+      if (cur->ppid == mypid && !cur->group_leader) {
         /* remove from zombie_list */
         if (prev)
           prev->next = cur->next;
@@ -380,8 +846,7 @@ int proc_wait_and_reap(void) {
 
         /* free child's stack */
         printk(BLUE "[proc]: \tReaping child pid=%d: free stack" RESET "\n", childpid);
-        void *stk = (void *)(cur->stacktop - PAGE_SIZE);
-        kfree(stk);
+        proc_free_stacks(cur);
 
         /* free child's heap virtual pages via vmm_unmap (which also frees physical pages) */
         if (cur->brk_base && cur->brk_size > 0) {
@@ -410,15 +875,49 @@ int proc_wait_and_reap(void) {
       cur = cur->next;
     }
 
-    /* No child available: block current process and schedule others */
-    current_proc->pstat = BLOCKED;
-    /* push onto blocked_list */
-    current_proc->next = blocked_list;
-    blocked_list = current_proc;
+    /* No child available: sleep until proc_exit of a child wakes us, then look again */
+    proc_sleep_on(&current_proc->child_wq, 0);
+  }
+}
 
-    /* context switch to another process */
-    schedule();
-    /* when we regain CPU, loop and check zombie_list again */
+// find a non-running process by pid in ready_queue, blocked_list or zombie_list
+static PCB *find_queued_proc(int pid) {
+  PCB *lists[3] = {ready_queue ? ready_queue->head : NULL, blocked_list, zombie_list};
+  for (int l = 0; l < 3; l++)
+    for (PCB *p = lists[l]; p; p = p->next)
+      if (p->pid == pid)
+        return p;
+  return NULL;
+}
+
+PCB *proc_find(int pid) {
+  if (current_proc && current_proc->pid == pid)
+    return current_proc;
+  PCB *p = find_queued_proc(pid);
+  return (p && p->pstat != TERMINATED) ? p : NULL;
+}
+
+// hard-kill every thread of the group led by 'leader' (exit of the whole group)
+static void kill_group_threads(PCB *leader) {
+  PCB *lists[3];
+  int found = 1;
+  while (found) {
+    found = 0;
+    lists[0] = ready_queue ? ready_queue->head : NULL;
+    lists[1] = blocked_list;
+    lists[2] = zombie_list;
+    for (int l = 0; l < 3 && !found; l++) {
+      for (PCB *p = lists[l]; p; p = p->next) {
+        // a deferred kill (p->killed) stays queued until p finishes its fs operation
+        if (p->group_leader == leader && !p->killed) {
+          // proc_kill unlinks and frees p, so restart the scan afterwards
+          proc_kill(p->pid);
+          intr_off();
+          found = 1;
+          break;
+        }
+      }
+    }
   }
 }
 
@@ -427,32 +926,39 @@ void proc_exit(void) {
   if (!current_proc)
     return;
 
+  /* a process leaving takes its threads with it, since they share its heap */
+  if (!current_proc->group_leader)
+    kill_group_threads(current_proc);
+
+  /* its FP state is dead: the next FP user need not preserve it */
+  fpu_release(current_proc);
+  /* and its deadline bandwidth can be admitted to others */
+  dl_release(current_proc);
+  strace_release(current_proc);
+  uring_release(current_proc);
+  /* close its fds now, so pipe peers see EOF without waiting for the reap */
+  fd_release_all(current_proc);
+  /* its code is not run again: a private ELF image can go */
+  image_put(current_proc->image);
+  current_proc->image = NULL;
+
   current_proc->pstat = TERMINATED;
   current_proc->next = zombie_list;
   zombie_list = current_proc;
   printk(BLUE "[proc]: \tProcess %d exited, added to zombie list." RESET "\n", current_proc->pid);
 
-  /* If parent is blocked waiting (in blocked_list), wake it up */
-  int ppid = current_proc->ppid;
-  if (ppid != 0) {
-    PCB *prev = NULL;
-    PCB *cur = blocked_list;
-    while (cur) {
-      if (cur->pid == ppid) {
-        /* remove from blocked_list */
-        if (prev)
-          prev->next = cur->next;
-        else
-          blocked_list = cur->next;
-
-        /* wake up parent: set READY and enqueue */
-        cur->pstat = READY;
-        enqueue(ready_queue, cur);
-        break;
-      }
-      prev = cur;
-      cur = cur->next;
-    }
+  /* wake the parent if it is in wait() (only there: any other sleep of it, a timed one
+   * included, is none of our business), and any thread joining us */
+  PCB *parent = current_proc->ppid ? proc_find(current_proc->ppid) : NULL;
+  if (parent)
+    proc_wakeup(&parent->child_wq, -1);
+  int mypid = current_proc->pid;
+  PCB *cur = blocked_list;
+  while (cur) {
+    PCB *next = cur->next;
+    if (cur->join_tid == mypid)
+      proc_wake(cur);
+    cur = next;
   }
 
   schedule();
@@ -484,8 +990,7 @@ void zombies_free(void) {
 
       // Free stack
       printk(BLUE "[proc]: \tReaping orphan pid=%d: free stack" RESET "\n", pid);
-      void *stk = (void *)(cur->stacktop - PAGE_SIZE);
-      kfree(stk);
+      proc_free_stacks(cur);
 
       // Free heap: unmap user heap pages and free the underlying physical pages
       if (cur->brk_base && cur->brk_size > 0) {
@@ -599,6 +1104,31 @@ int proc_kill(int pid) {
   if (idle_proc && idle_proc->pid == pid)
     goto not_found;
 
+  {
+    PCB *target = find_queued_proc(pid);
+    // in the middle of a filesystem operation (asleep or woken and not yet run): freeing
+    // it now would leave fs_mutex held and a disk transfer aimed at its freed stack, so
+    // it exits on its way back to user mode instead (syscall_dispatch)
+    if (target && target->in_io) {
+      target->killed = 1;
+      intr_on();
+      return 0;
+    }
+    // a thread killing its own leader: the heap and fds it uses go with the leader, and
+    // kill_group_threads cannot see the running caller. Detach it from the group (it is
+    // reaped as an orphan), kill the leader and the other threads, then exit
+    if (target && current_proc && current_proc->group_leader == target) {
+      current_proc->group_leader = NULL;
+      current_proc->ppid = 0;
+      proc_kill(pid);
+      proc_exit();
+      // not reached
+    }
+    // killing a process also kills its threads, which would otherwise keep using its heap
+    if (target && !target->group_leader)
+      kill_group_threads(target);
+  }
+
   // if killing current process, just call proc_exit (never returns)
   if (current_proc && current_proc->pid == pid) {
     intr_on();
@@ -642,6 +1172,8 @@ int proc_kill(int pid) {
         else
           blocked_list = next;
 
+        // unlink its wait entries before the stack holding them is freed
+        wq_remove_all(cur);
         free_pcb_resources(cur);
         intr_on();
         return 0;
@@ -681,13 +1213,15 @@ void schedule(void) {
   // disable interrupt
   intr_off();
 
-  PCB *next = dequeue(ready_queue);
+  // ask the scheduler classes (deadline first, then the fair policy) who runs next
+  PCB *next = sched_pick_next(current_proc);
 
   // === if queue is empty, decide which process will run? ===
   if (!next) {
     // 1. If the current process is valid, running, and not the Idle process
-    //    Then let it keep running (if Round Robin has no object to rotate, it runs by itself)
-    if (current_proc && current_proc->pstat == RUNNING && current_proc != idle_proc) {
+    //    Then let it keep running (if the fair class has no object to rotate, it runs by itself)
+    if (current_proc && current_proc->pstat == RUNNING && current_proc != idle_proc &&
+        !dl_task(current_proc)) {
       next = current_proc;
     }
     // 2. In other situations:
@@ -703,6 +1237,7 @@ void schedule(void) {
   // However, for the zombie cleanup logic (try_free_zombies)
   // we can still go through the switch process even for Idle->Idle
   if (next == current_proc && next->pstat == RUNNING) {
+    set_next_timer(sched_timer_interval(next));
     // Still need to try to reap zombies
     // (for example, a process just exited, and now Idle is running)
     zombies_free();
@@ -719,6 +1254,7 @@ void schedule(void) {
   if (!old) {
     next->pstat = RUNNING;
     current_proc = next;
+    fpu_switch(NULL, next);
     switch_context(&boot_ctx, &next->regstat);
     intr_on();
     return;
@@ -729,7 +1265,7 @@ void schedule(void) {
     old->pstat = READY;
     // Note: The Idle process never enters the ready_queue
     if (old != idle_proc) {
-      enqueue(ready_queue, old);
+      sched_enqueue(old, 0);
     }
   }
 
@@ -740,6 +1276,12 @@ void schedule(void) {
   next->pstat = RUNNING;
   current_proc = next;
 
+  // the slice may end early for a deadline task's budget or a pending replenishment
+  set_next_timer(sched_timer_interval(next));
+
+  // save FP registers only if old dirtied them; next starts with the FPU off
+  fpu_switch(old, next);
+
   // switch context
   switch_context(&old->regstat, &next->regstat);
 
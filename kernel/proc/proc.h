@@ -14,6 +14,7 @@
 #ifndef _PROC_H_
 #define _PROC_H_
 
+#include "../fs/file.h"
 #include "../include/types.h"
 #include <stddef.h>
 
@@ -22,6 +23,24 @@ typedef enum ProcessState { READY = 0, RUNNING, BLOCKED, TERMINATED } ProcState;
 
 // forward declare for pointer type
 typedef struct ProcessControlBlock PCB;
+typedef struct WaitQueue waitqueue;
+
+// one registration of a sleeping process on a wait queue; entries live on the
+// sleeper's stack and a process may hold several at once (e.g. poll). Callback
+// entries (wq_add_func) instead stay queued across wakeups and belong to no process.
+typedef struct WaitEntry {
+  PCB *proc;               // sleeping process
+  waitqueue *wq;           // queue this entry is linked on (NULL if not queued)
+  uint64_t key;            // optional wait key (futex address), 0 if unused
+  void (*func)(struct WaitEntry *we); // callback entry: run on wakeup, NULL = wake proc
+  struct WaitEntry *next;  // next entry on the same wait queue
+  struct WaitEntry *pnext; // next entry registered by the same process
+} wait_entry;
+
+// list of processes waiting for one event
+struct WaitQueue {
+  wait_entry *head;
+};
 
 // define PCB
 struct ProcessControlBlock {
@@ -34,10 +53,39 @@ struct ProcessControlBlock {
   int ppid;             // parent pid (0 for kernel/init)
   void *brk_base;       // program break base (heap)
   uint64_t brk_size;    // allocated heap size in bytes
-  uint64_t cpu_time;    // cpu consumed time
-  uint64_t remain_time; // remaining time slice
+  uint64_t cpu_time;    // cpu consumed time (timer ticks)
+  uint64_t remain_time; // remaining time slice (timer ticks, MLFQ)
   uint64_t arriv_time;  // arrival time
-  RegState regstat;     // saved register state for context switch
+  struct file *ofile[NOFILE]; // fd table (fs/file.h), unused by threads (leader's is shared)
+  uint8_t fd_flags[NOFILE];   // FD_* of each fd
+  PCB *group_leader;    // owning process for threads (shares its heap), NULL for processes
+  int join_tid;         // tid this process is blocked joining, 0 if none
+  waitqueue child_wq;   // this process in wait(), woken when a child exits
+  uint64_t exit_val;    // thread return value, collected by thread_join
+  wait_entry *waits;    // wait queue registrations while sleeping
+  uint64_t wake_at;     // mtime deadline of a timed sleep, 0 if none
+  RegState regstat;     // kernel context saved by switch_context
+  uint64_t kstacktop;   // kernel stack top (traps from this process land here)
+  RegState *tf;         // user register state saved on trap entry (top of kernel stack)
+  FPState fpstate;      // FP registers, valid unless this process owns the live FPU state
+  int fp_used;          // process has executed FP instructions at least once
+  uint64_t dl_runtime;      // deadline class: budget per period (mtime ticks)
+  uint64_t dl_deadline;     // relative deadline
+  uint64_t dl_period;       // period, 0 = normal round-robin process
+  uint64_t dl_abs_deadline; // absolute deadline of the current job
+  uint64_t dl_period_start; // start of the current period
+  uint64_t dl_last_start;   // mtime when the budget was last charged
+  int64_t dl_budget;        // remaining budget in the current period
+  int dl_throttled;         // budget exhausted or job done: wait for next period
+  int dl_job_done;          // current job finished via sched_yield
+  uint64_t dl_misses;       // deadlines missed
+  int sched_level;          // MLFQ level, 0 = highest priority
+  struct strace_ring *strace; // syscall trace ring, NULL = not traced
+  struct uring_ctx *uring;    // io ring (syscall/uring.h), NULL = none
+  struct exec_image *image;   // ELF image it runs (proc/exec.h), NULL = linked-in program
+  int no_sleep;               // kernel thread that must not block mid-request (SQPOLL)
+  int in_io;                  // inside a filesystem operation (proc_io_begin), not killable
+  int killed;                 // kill deferred until the syscall in progress returns
   PCB *next;            // link list pointer, for queue managing
 };
 
@@ -61,9 +109,75 @@ void schedule(void);
 PCB *get_current_proc(void);
 /* fork current process: return child's pid, or -1 on error */
 PCB *proc_fork(uint64_t mepc);
+/* create a process directly from an entry point (no fork copy): argv strings are copied
+ * onto the child's fresh stack and passed as a0=argc, a1=argv (sp points at argc, argv,
+ * an empty envp and auxv, as a static binary's _start expects). The child inherits the
+ * caller's fds except FD_CLOEXEC ones; in_fd/out_fd (caller fds, -1 = keep) become its
+ * fd 0/1. On success the child takes over the caller's reference to img (may be NULL).
+ * Returns the child PCB or NULL.
+ */
+PCB *proc_spawn(const char *name, uint64_t entrypoint, struct exec_image *img,
+                char *const argv[], int in_fd, int out_fd);
+/* replace the current process's program: restart at entrypoint on an empty stack with
+ * argv laid out as for proc_spawn, running img (reference taken over on success).
+ * The group's threads are killed first. Returns 0, or -1 (argv too large, called by a
+ * thread, or a thread busy in the filesystem that cannot be killed yet)
+ */
+int proc_exec(const char *name, uint64_t entrypoint, struct exec_image *img, char *const argv[]);
+/* create a thread in the current thread group: it starts at fn with a0=arg on its own
+ * stack (ustack if non-zero, else its kernel-allocated stack page) and shares the
+ * group's heap and fds. Returns the thread PCB or NULL.
+ */
+PCB *proc_thread_create(uint64_t fn, uint64_t arg, uint64_t ustack);
+/* wait for thread tid of the current group to exit, reap it and store its return
+ * value in *retval; return tid or -1 if there is no such thread
+ */
+int proc_thread_join(int tid, uint64_t *retval);
+/* heap/fd owner of p: the group leader for threads, p itself for processes */
+PCB *proc_group_leader(PCB *p);
 /* wait for a child in zombie list and reap it; return pid or -1 if none */
 int proc_wait_and_reap(void);
 
+// wait queues: register the current process with wq_add(), then proc_sleep().
+// Callers must disable interrupts before testing their wait condition so that a
+// wakeup cannot slip in between the test and the sleep.
+void wq_add(waitqueue *wq, wait_entry *we, uint64_t key);
+void wq_remove(wait_entry *we);
+// drop every registration of p (e.g. poll found an fd ready and will not sleep)
+void wq_remove_all(PCB *p);
+// link a callback entry: every wakeup of wq calls func(we) and leaves it queued,
+// until wq_remove (epoll keeps one per watched file)
+void wq_add_func(waitqueue *wq, wait_entry *we, void (*func)(wait_entry *we));
+// move a still-sleeping registration to another queue/key (futex requeue)
+void wq_requeue(wait_entry *we, waitqueue *to, uint64_t key);
+// block current process until woken or until mtime reaches deadline (0 = no timeout);
+// returns 0 when woken, -1 on timeout. Drops all of the process's registrations.
+int proc_sleep(uint64_t deadline);
+// wq_add + proc_sleep for the common single-queue case
+int proc_sleep_on(waitqueue *wq, uint64_t deadline);
+// whether the current context can block in proc_sleep: not at boot, in idle or in a
+// no_sleep kernel thread, which have to poll instead
+int proc_may_sleep(void);
+/* bracket an operation that must not be cut short by a kill (it holds fs_mutex, or has
+ * a disk transfer in flight into its kernel stack): proc_kill only marks the process
+ * killed meanwhile, and it exits when its syscall returns. Nests
+ */
+void proc_io_begin(void);
+void proc_io_end(void);
+// make a sleeping process runnable again
+void proc_wake(PCB *p);
+// put a READY process (new, woken or preempted) on the ready queue
+void proc_ready(PCB *p);
+// wake up to n sleepers on wq (n < 0: all) and run its callback entries; returns how
+// many sleepers were woken
+int proc_wakeup(waitqueue *wq, int n);
+// called on every timer tick: wake sleepers whose deadline has passed and charge
+// the running process's time slice
+void proc_timer_tick(void);
+
+// find a live process by pid (current, ready or blocked), NULL if none
+PCB *proc_find(int pid);
+
 // kill a process by pid: return 0 on success, -1 if not found/invalid
 int proc_kill(int pid);
 
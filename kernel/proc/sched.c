@@ -0,0 +1,178 @@
+/*
+ * Lrix
+ * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+ *
+ * This program is released under the terms of the GNU General Public License version 2(GPLv2).
+ * See https://opensource.org/licenses/GPL-2.0 for more information.
+ *
+ * Project homepage: https://github.com/lrisguan/Lrix
+ * Description: A scratch implemention of OS based on RISC-V
+ */
+
+
+// sched.c - scheduler class dispatch, round-robin and multi-level feedback queue
+
+#include "sched.h"
+#include "../include/riscv.h"
+#include "../string/string.h"
+#include "../trap/trap.h"
+#include "sched_dl.h"
+
+#ifdef SCHED_DEFAULT_MLFQ
+static const struct sched_class *fair_class = &mlfq_sched_class;
+#else
+static const struct sched_class *fair_class = &rr_sched_class;
+#endif
+
+static const struct sched_class *class_of(PCB *p) {
+  return dl_task(p) ? &dl_sched_class : fair_class;
+}
+
+int procqueue_remove(procqueue *q, PCB *p) {
+  PCB *prev = NULL;
+  for (PCB *cur = q->head; cur; prev = cur, cur = cur->next) {
+    if (cur != p)
+      continue;
+    if (prev)
+      prev->next = p->next;
+    else
+      q->head = p->next;
+    if (q->tail == p)
+      q->tail = prev;
+    p->next = NULL;
+    q->count--;
+    return 1;
+  }
+  return 0;
+}
+
+void sched_enqueue(PCB *p, int flags) { class_of(p)->enqueue(ready_queue, p, flags); }
+
+void sched_dequeue(PCB *p) { class_of(p)->dequeue(ready_queue, p); }
+
+PCB *sched_pick_next(PCB *cur) {
+  PCB *next = dl_sched_class.pick_next(ready_queue, cur);
+  if (!next)
+    next = fair_class->pick_next(ready_queue, cur);
+  return next;
+}
+
+void sched_tick(PCB *cur) {
+  if (cur)
+    class_of(cur)->tick(cur);
+}
+
+void sched_yield(PCB *cur) {
+  if (cur)
+    class_of(cur)->yield(cur);
+}
+
+uint64_t sched_timer_interval(PCB *next) {
+  return dl_timer_interval(next, ready_queue, read_mtime(), TIMER_TICK);
+}
+
+int sched_set_policy(const char *name) {
+  const struct sched_class *c;
+  if (strcmp(name, rr_sched_class.name) == 0)
+    c = &rr_sched_class;
+  else if (strcmp(name, mlfq_sched_class.name) == 0)
+    c = &mlfq_sched_class;
+  else
+    return -1;
+  fair_class = c;
+  return 0;
+}
+
+const char *sched_policy_name(void) { return fair_class->name; }
+
+// ---------------- round-robin ----------------
+
+static void fair_enqueue(procqueue *q, PCB *p, int flags) {
+  (void)flags;
+  enqueue(q, p);
+}
+
+static void fair_dequeue(procqueue *q, PCB *p) { procqueue_remove(q, p); }
+
+// first queued process of the fair class, in FIFO order
+static PCB *rr_pick_next(procqueue *q, PCB *cur) {
+  (void)cur;
+  for (PCB *p = q->head; p; p = p->next) {
+    if (!dl_task(p)) {
+      procqueue_remove(q, p);
+      return p;
+    }
+  }
+  return NULL;
+}
+
+static void rr_tick(PCB *cur) { cur->cpu_time++; }
+
+static void rr_yield(PCB *cur) { (void)cur; }
+
+const struct sched_class rr_sched_class = {
+    .name = "rr",
+    .enqueue = fair_enqueue,
+    .dequeue = fair_dequeue,
+    .pick_next = rr_pick_next,
+    .tick = rr_tick,
+    .yield = rr_yield,
+};
+
+// ---------------- multi-level feedback queue ----------------
+
+static uint64_t mlfq_ticks = 0;
+
+static uint64_t mlfq_slice(int level) { return 1ULL << level; }
+
+static void mlfq_enqueue(procqueue *q, PCB *p, int flags) {
+  // a process that slept (e.g. the shell in sys_getc) is interactive: move it up
+  if ((flags & ENQ_WAKEUP) && p->sched_level > 0) {
+    p->sched_level--;
+    p->remain_time = 0;
+  }
+  if (p->remain_time == 0)
+    p->remain_time = mlfq_slice(p->sched_level);
+  enqueue(q, p);
+}
+
+// the highest-level queued process, FIFO within a level; cur keeps the CPU while
+// its slice lasts unless a process of a higher level is waiting
+static PCB *mlfq_pick_next(procqueue *q, PCB *cur) {
+  PCB *best = NULL;
+  for (PCB *p = q->head; p; p = p->next) {
+    if (!dl_task(p) && (!best || p->sched_level < best->sched_level))
+      best = p;
+  }
+  if (cur && cur->pstat == RUNNING && !dl_task(cur) && cur->remain_time > 0 &&
+      (!best || cur->sched_level <= best->sched_level))
+    return cur;
+  if (best)
+    procqueue_remove(q, best);
+  return best;
+}
+
+static void mlfq_tick(PCB *cur) {
+  cur->cpu_time++;
+  // used up its slice: one level down, preempted by the next pick_next
+  if (cur->remain_time > 0 && --cur->remain_time == 0 && cur->sched_level < MLFQ_LEVELS - 1)
+    cur->sched_level++;
+
+  if (++mlfq_ticks % MLFQ_BOOST_TICKS == 0) {
+    for (PCB *p = ready_queue->head; p; p = p->next)
+      p->sched_level = 0;
+    cur->sched_level = 0;
+  }
+}
+
+// give up the rest of the slice without being demoted
+static void mlfq_yield(PCB *cur) { cur->remain_time = 0; }
+
+const struct sched_class mlfq_sched_class = {
+    .name = "mlfq",
+    .enqueue = mlfq_enqueue,
+    .dequeue = fair_dequeue,
+    .pick_next = mlfq_pick_next,
+    .tick = mlfq_tick,
+    .yield = mlfq_yield,
+};
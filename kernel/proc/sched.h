@@ -0,0 +1,69 @@
+/*
+ * Lrix
+ * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+ *
+ * This program is released under the terms of the GNU General Public License version 2(GPLv2).
+ * See https://opensource.org/licenses/GPL-2.0 for more information.
+ *
+ * Project homepage: https://github.com/lrisguan/Lrix
+ * Description: A scratch implemention of OS based on RISC-V
+ */
+
+
+// sched.h - scheduler classes
+//
+// All READY processes live in ready_queue so that ps/kill/exit can walk them;
+// a class decides which of its processes runs next. Classes are consulted in
+// order: the deadline class first, then the fair policy selected at boot
+// (make SCHED=rr|mlfq) or at runtime (sys_sched_policy / shell 'sched').
+
+#ifndef _SCHED_H_
+#define _SCHED_H_
+
+#include "proc.h"
+
+// enqueue flags
+#define ENQ_WAKEUP 1 // the process was sleeping (not new or preempted)
+
+// MLFQ: level 0 is the highest priority; a level's time slice is 1 << level ticks
+#define MLFQ_LEVELS 3
+// every MLFQ_BOOST_TICKS timer ticks all ready processes go back to level 0,
+// so that CPU-bound processes at the bottom cannot starve
+#define MLFQ_BOOST_TICKS 100
+
+struct sched_class {
+  const char *name;
+  // p became READY: append it to q and update the class's state
+  void (*enqueue)(procqueue *q, PCB *p, int flags);
+  // unlink READY process p from q
+  void (*dequeue)(procqueue *q, PCB *p);
+  // unlink and return the next process of this class from q, return cur to
+  // keep it running, or NULL if the class has nothing to run
+  PCB *(*pick_next)(procqueue *q, PCB *cur);
+  // a timer tick hit while cur (a process of this class) was running
+  void (*tick)(PCB *cur);
+  // cur gives up the CPU voluntarily
+  void (*yield)(PCB *cur);
+};
+
+extern const struct sched_class dl_sched_class;
+extern const struct sched_class rr_sched_class;
+extern const struct sched_class mlfq_sched_class;
+
+// class helpers operating on ready_queue; callers disable interrupts
+void sched_enqueue(PCB *p, int flags);
+void sched_dequeue(PCB *p);
+PCB *sched_pick_next(PCB *cur);
+void sched_tick(PCB *cur);
+void sched_yield(PCB *cur);
+// timer interval for running next (the deadline class may need an early tick)
+uint64_t sched_timer_interval(PCB *next);
+
+// fair policy: select by name ("rr" or "mlfq"), return 0 or -1 if unknown
+int sched_set_policy(const char *name);
+const char *sched_policy_name(void);
+
+// unlink p from q; return 1 if it was queued
+int procqueue_remove(procqueue *q, PCB *p);
+
+#endif /* _SCHED_H_ */
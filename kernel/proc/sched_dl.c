@@ -0,0 +1,217 @@
+/*
+ * Lrix
+ * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+ *
+ * This program is released under the terms of the GNU General Public License version 2(GPLv2).
+ * See https://opensource.org/licenses/GPL-2.0 for more information.
+ *
+ * Project homepage: https://github.com/lrisguan/Lrix
+ * Description: A scratch implemention of OS based on RISC-V
+ */
+
+
+// sched_dl.c - EDF scheduling with constant-bandwidth-server budget enforcement
+//
+// Deadline tasks stay in the normal ready queue; the picker scans it for the
+// runnable one with the earliest absolute deadline before the round-robin
+// class gets a chance. A task that exhausts its budget is throttled (skipped
+// by both pickers) until its next period starts.
+
+#include "sched_dl.h"
+#include "sched.h"
+#include "../include/riscv.h"
+
+// admitted utilization, sum of runtime/period in 1/1024 units
+static uint64_t dl_total_util = 0;
+static uint64_t dl_total_misses = 0;
+
+static uint64_t dl_util(uint64_t runtime, uint64_t period) {
+  return (runtime << DL_UTIL_SHIFT) / period;
+}
+
+int dl_task(PCB *p) { return p && p->dl_period != 0; }
+
+// begin a new job/period at 'start' with a full budget
+static void dl_new_period(PCB *p, uint64_t start) {
+  p->dl_period_start = start;
+  p->dl_abs_deadline = start + p->dl_deadline;
+  p->dl_budget = (int64_t)p->dl_runtime;
+  p->dl_throttled = 0;
+  p->dl_job_done = 0;
+}
+
+int dl_setattr(PCB *p, uint64_t runtime, uint64_t deadline, uint64_t period) {
+  if (!p)
+    return -1;
+  uint64_t old_util = dl_task(p) ? dl_util(p->dl_runtime, p->dl_period) : 0;
+
+  if (runtime == 0) {
+    dl_total_util -= old_util;
+    p->dl_runtime = p->dl_deadline = p->dl_period = 0;
+    p->dl_throttled = 0;
+    return 0;
+  }
+
+  if (deadline == 0)
+    deadline = period;
+  if (period == 0 || runtime > deadline || deadline > period)
+    return -1;
+
+  // admission control: the new total utilization must stay schedulable
+  uint64_t util = dl_util(runtime, period);
+  if (dl_total_util - old_util + util > DL_UTIL_MAX)
+    return -1;
+  dl_total_util = dl_total_util - old_util + util;
+
+  p->dl_runtime = runtime;
+  p->dl_deadline = deadline;
+  p->dl_period = period;
+  p->dl_misses = 0;
+  uint64_t now = read_mtime();
+  dl_new_period(p, now);
+  p->dl_last_start = now;
+  return 0;
+}
+
+void dl_getattr(PCB *p, struct sched_attr *attr) {
+  attr->runtime = p->dl_runtime;
+  attr->deadline = p->dl_deadline;
+  attr->period = p->dl_period;
+  attr->misses = p->dl_misses;
+  attr->total_misses = dl_total_misses;
+}
+
+void dl_release(PCB *p) {
+  if (!dl_task(p))
+    return;
+  dl_total_util -= dl_util(p->dl_runtime, p->dl_period);
+  p->dl_period = 0;
+}
+
+static void dl_miss(PCB *p) {
+  p->dl_misses++;
+  dl_total_misses++;
+}
+
+// charge the CPU time p used since it was last charged and enforce its budget
+// (CBS throttling) and deadline (miss accounting)
+static void dl_account(PCB *p, uint64_t now) {
+  // a finished job is no longer charged; a task that just blocked still pays
+  // for the time it ran before sleeping
+  if (!dl_task(p) || p->dl_job_done || p->pstat == TERMINATED)
+    return;
+  p->dl_budget -= (int64_t)(now - p->dl_last_start);
+  p->dl_last_start = now;
+
+  if (now > p->dl_abs_deadline) {
+    // still working on a job whose deadline has passed: count it and let the
+    // job continue in the next period (CBS deadline postponement)
+    dl_miss(p);
+    dl_new_period(p, now);
+    return;
+  }
+  if (p->dl_budget <= 0)
+    p->dl_throttled = 1; // out of budget until the next period
+}
+
+// start new periods for throttled tasks whose replenishment time has come
+static void dl_replenish(procqueue *q, uint64_t now) {
+  for (PCB *p = q->head; p; p = p->next) {
+    if (!dl_task(p) || !p->dl_throttled)
+      continue;
+    uint64_t next_start = p->dl_period_start + p->dl_period;
+    if (now < next_start)
+      continue;
+    // throttled on budget (not by finishing the job) past its deadline: a miss
+    if (!p->dl_job_done && now > p->dl_abs_deadline)
+      dl_miss(p);
+    dl_new_period(p, next_start + p->dl_period <= now ? now : next_start);
+  }
+}
+
+static int dl_runnable(PCB *p) { return dl_task(p) && !p->dl_throttled; }
+
+// the runnable deadline task in q with the earliest absolute deadline, unlinked;
+// cur (if a running deadline task) keeps the CPU unless a queued one beats it
+static PCB *dl_pick(procqueue *q, PCB *cur, uint64_t now) {
+  PCB *best = NULL;
+  for (PCB *p = q->head; p; p = p->next) {
+    if (dl_runnable(p) && (!best || p->dl_abs_deadline < best->dl_abs_deadline))
+      best = p;
+  }
+
+  if (cur && cur->pstat == RUNNING && dl_runnable(cur) &&
+      (!best || cur->dl_abs_deadline <= best->dl_abs_deadline))
+    return cur;
+  if (!best)
+    return NULL;
+
+  procqueue_remove(q, best);
+  best->dl_last_start = now;
+  return best;
+}
+
+static void dl_wakeup(PCB *p, uint64_t now) {
+  if (!dl_task(p))
+    return;
+  // CBS wakeup rule (simplified): a task waking after its deadline gets a fresh
+  // period instead of a stale, already-missed deadline
+  if (now >= p->dl_abs_deadline)
+    dl_new_period(p, now);
+}
+
+// p finished its current job: sleep until the next period
+static void dl_yield(PCB *p) {
+  if (!dl_task(p))
+    return;
+  dl_account(p, read_mtime());
+  p->dl_job_done = 1;
+  p->dl_throttled = 1;
+}
+
+uint64_t dl_timer_interval(PCB *next, procqueue *q, uint64_t now, uint64_t tick) {
+  uint64_t interval = tick;
+  // fire when the running task's budget runs out ...
+  if (dl_runnable(next) && next->dl_budget > 0 && (uint64_t)next->dl_budget < interval)
+    interval = (uint64_t)next->dl_budget;
+  // ... or when a throttled task gets its next period
+  for (PCB *p = q->head; p; p = p->next) {
+    if (!dl_task(p) || !p->dl_throttled)
+      continue;
+    uint64_t at = p->dl_period_start + p->dl_period;
+    uint64_t delta = at > now ? at - now : 1;
+    if (delta < interval)
+      interval = delta;
+  }
+  return interval;
+}
+
+static void dl_enqueue(procqueue *q, PCB *p, int flags) {
+  if (flags & ENQ_WAKEUP)
+    dl_wakeup(p, read_mtime());
+  enqueue(q, p);
+}
+
+static void dl_dequeue(procqueue *q, PCB *p) { procqueue_remove(q, p); }
+
+// charge the outgoing task, start new periods for throttled ones, then pick the
+// earliest deadline
+static PCB *dl_pick_next(procqueue *q, PCB *cur) {
+  uint64_t now = read_mtime();
+  if (cur)
+    dl_account(cur, now);
+  dl_replenish(q, now);
+  return dl_pick(q, cur, now);
+}
+
+// budget and deadline are enforced in dl_pick_next against mtime, not in ticks
+static void dl_tick(PCB *cur) { cur->cpu_time++; }
+
+const struct sched_class dl_sched_class = {
+    .name = "deadline",
+    .enqueue = dl_enqueue,
+    .dequeue = dl_dequeue,
+    .pick_next = dl_pick_next,
+    .tick = dl_tick,
+    .yield = dl_yield,
+};
@@ -0,0 +1,41 @@
+/*
+ * Lrix
+ * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+ *
+ * This program is released under the terms of the GNU General Public License version 2(GPLv2).
+ * See https://opensource.org/licenses/GPL-2.0 for more information.
+ *
+ * Project homepage: https://github.com/lrisguan/Lrix
+ * Description: A scratch implemention of OS based on RISC-V
+ */
+
+
+// sched_dl.h - earliest-deadline-first (SCHED_DEADLINE-style) scheduling class
+// (dl_sched_class in sched.h)
+
+#ifndef _SCHED_DL_H_
+#define _SCHED_DL_H_
+
+#include "../syscall/syscall.h"
+#include "proc.h"
+
+// total deadline utilization admitted, in 1/1024 units (the rest is left to
+// the normal class so that it cannot be starved completely)
+#define DL_UTIL_SHIFT 10
+#define DL_UTIL_MAX ((95 << DL_UTIL_SHIFT) / 100)
+
+// 1 if p belongs to the deadline class
+int dl_task(PCB *p);
+
+// set/clear the deadline parameters of p (runtime == 0 switches back to normal);
+// returns 0, or -1 if the parameters are invalid or fail admission control
+int dl_setattr(PCB *p, uint64_t runtime, uint64_t deadline, uint64_t period);
+void dl_getattr(PCB *p, struct sched_attr *attr);
+
+// give back p's bandwidth when it exits or is killed
+void dl_release(PCB *p);
+
+// timer interval that lets the budget/replenishment events fire on time
+uint64_t dl_timer_interval(PCB *next, procqueue *q, uint64_t now, uint64_t tick);
+
+#endif /* _SCHED_DL_H_ */
@@ -10,19 +10,25 @@
  */
 
 #include "syscall.h"
+#include "../fs/file.h"
 #include "../fs/fs.h"
+#include "../fs/pipe.h"
+#include "../fs/poll.h"
 #include "../include/log.h"
 #include "../include/riscv.h"
 #include "../mem/kmem.h"
 #include "../mem/vmm.h"
+#include "../proc/exec.h"
+#include "../proc/futex.h"
 #include "../proc/proc.h"
+#include "../proc/sched.h"
+#include "../proc/sched_dl.h"
+#include "../string/string.h"
 #include "../uart/uart.h"
+#include "uring.h"
+#include "vclock.h"
 #include <stdint.h>
 
-/* CLINT base used for uptime */
-#define CLINT_BASE 0x02000000UL
-#define CLINT_MTIME (CLINT_BASE + 0xBFF8)
-
 /* Simple syscall implementations */
 static uint64_t sys_getpid(uint64_t args[6], uint64_t epc) {
   PCB *p = get_current_proc();
@@ -45,70 +51,232 @@ static uint64_t sys_uptime(uint64_t args[6], uint64_t epc) {
   return *mtime;
 }
 
+// the clock data page: constant after boot, so readers need no sequence count
+static const struct vclock vclock_page __attribute__((aligned(PAGE_SIZE))) = {
+    .version = VCLOCK_VERSION,
+    .shift = 32,
+    .freq = MTIME_FREQ,
+    .mult = (NSEC_PER_SEC << 32) / MTIME_FREQ,
+};
+
+static uint64_t sys_vclock(uint64_t args[6], uint64_t epc) {
+  (void)args;
+  (void)epc;
+  return (uint64_t)&vclock_page;
+}
+
+// sleep for args[0] mtime ticks: the caller is blocked and the timer tick wakes it,
+// so other processes run meanwhile instead of the CPU spinning here
 static uint64_t sys_sleep(uint64_t args[6], uint64_t epc) {
   uint64_t ticks = args[0];
   (void)epc;
-  volatile uint64_t *mtime = (uint64_t *)CLINT_MTIME;
-  uint64_t start = *mtime;
-  while ((*mtime - start) < ticks) {
-    asm volatile("wfi");
-  }
+  if (ticks == 0)
+    return 0;
+  intr_off();
+  proc_sleep(read_mtime() + ticks);
   return 0;
 }
 
+/* file operations may sleep (pipes, console, disk), and another thread sharing the fd
+ * table may close the fd meanwhile: each one holds its own reference (fget)
+ */
+static int64_t fd_rw(PCB *p, int fd, const struct iovec *iov, int iovcnt, int64_t off,
+                     int write) {
+  struct file *f = fget(p, fd);
+  int64_t r = write ? file_write(f, iov, iovcnt, off) : file_read(f, iov, iovcnt, off);
+  file_close(f);
+  return r;
+}
+
+int64_t ksys_write(PCB *p, int fd, const void *buf, uint64_t len) {
+  struct iovec v = {(void *)buf, len};
+  return fd_rw(p, fd, &v, 1, -1, 1);
+}
+
+int64_t ksys_writev(PCB *p, int fd, const struct iovec *iov, int iovcnt) {
+  return fd_rw(p, fd, iov, iovcnt, -1, 1);
+}
+
+int64_t ksys_open(PCB *p, const char *name, int flags) {
+  struct file *f = fs_open(name, flags & O_CREATE);
+  if (!f)
+    return -1;
+  int fd = fd_install(p, f, (flags & O_CLOEXEC) ? FD_CLOEXEC : 0);
+  if (fd < 0)
+    file_close(f);
+  return fd;
+}
+
+int64_t ksys_read(PCB *p, int fd, void *buf, uint64_t len) {
+  struct iovec v = {buf, len};
+  return fd_rw(p, fd, &v, 1, -1, 0);
+}
+
+int64_t ksys_readv(PCB *p, int fd, const struct iovec *iov, int iovcnt) {
+  return fd_rw(p, fd, iov, iovcnt, -1, 0);
+}
+
+int64_t ksys_close(PCB *p, int fd) { return fd_close(p, fd); }
+
 static uint64_t sys_write(uint64_t args[6], uint64_t epc) {
-  uint64_t fd = args[0];
-  const char *buf = (const char *)args[1];
-  uint64_t len = args[2];
   (void)epc;
-  if (fd == 1 || fd == 2) {
-    for (uint64_t i = 0; i < len; i++) {
-      char c = buf[i];
-      printk("%c", c);
-    }
-    return len;
-  }
-  // filesystem-backed fds live in [FS_FD_BASE, FS_FD_BASE + FS_MAX_FILES)
-  if (fd >= FS_FD_BASE && fd < FS_FD_BASE + FS_MAX_FILES)
-    return (uint64_t)fs_write((int)fd, buf, (int)len);
-  return (uint64_t)-1;
+  return (uint64_t)ksys_write(get_current_proc(), (int)args[0], (const void *)args[1], args[2]);
 }
 
 static uint64_t sys_open(uint64_t args[6], uint64_t epc) {
   (void)epc;
-  const char *name = (const char *)args[0];
-  int create = (int)args[1];
-  int fd;
-  if (create)
-    fd = fs_create(name);
-  else
-    fd = fs_open(name);
-  return (uint64_t)fd;
+  return (uint64_t)ksys_open(get_current_proc(), (const char *)args[0], (int)args[1]);
 }
 
 static uint64_t sys_read(uint64_t args[6], uint64_t epc) {
   (void)epc;
-  int fd = (int)args[0];
-  void *buf = (void *)args[1];
-  int n = (int)args[2];
-  if (fd >= FS_FD_BASE && fd < FS_FD_BASE + FS_MAX_FILES)
-    return (uint64_t)fs_read(fd, buf, n);
-  return (uint64_t)-1;
+  return (uint64_t)ksys_read(get_current_proc(), (int)args[0], (void *)args[1], args[2]);
 }
 
 static uint64_t sys_close(uint64_t args[6], uint64_t epc) {
   (void)epc;
-  int fd = (int)args[0];
-  if (fd >= FS_FD_BASE && fd < FS_FD_BASE + FS_MAX_FILES)
-    return (uint64_t)fs_close(fd);
-  return (uint64_t)-1;
+  return (uint64_t)ksys_close(get_current_proc(), (int)args[0]);
+}
+
+// lseek: args[0]=fd, args[1]=offset, args[2]=SEEK_*; only files on disk can seek
+static uint64_t sys_lseek(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  struct file *f = fget(get_current_proc(), (int)args[0]);
+  int64_t r = file_lseek(f, (int64_t)args[1], (int)args[2]);
+  file_close(f);
+  return (uint64_t)r;
+}
+
+// pread/pwrite: args[0]=fd, args[1]=buffer, args[2]=len, args[3]=file offset
+static uint64_t sys_pread(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  struct iovec v = {(void *)args[1], args[2]};
+  if (args[3] > UINT32_MAX)
+    return (uint64_t)-1;
+  return (uint64_t)fd_rw(get_current_proc(), (int)args[0], &v, 1, (int64_t)args[3], 0);
+}
+
+static uint64_t sys_pwrite(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  struct iovec v = {(void *)args[1], args[2]};
+  if (args[3] > UINT32_MAX)
+    return (uint64_t)-1;
+  return (uint64_t)fd_rw(get_current_proc(), (int)args[0], &v, 1, (int64_t)args[3], 1);
+}
+
+// readv/writev: args[0]=fd, args[1]=struct iovec array, args[2]=count (<= FS_IOV_MAX)
+static uint64_t sys_readv(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  return (uint64_t)ksys_readv(get_current_proc(), (int)args[0], (const struct iovec *)args[1],
+                              (int)args[2]);
+}
+
+static uint64_t sys_writev(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  return (uint64_t)ksys_writev(get_current_proc(), (int)args[0], (const struct iovec *)args[1],
+                               (int)args[2]);
+}
+
+// copy_file_range: args[0]=in fd, args[1]=out fd, args[2]=len; both must be disk files
+static uint64_t sys_copy_file_range(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  PCB *p = get_current_proc();
+  struct file *in = fget(p, (int)args[0]);
+  struct file *out = fget(p, (int)args[1]);
+  int64_t r = -1;
+  if (in && out && in->type == FILE_INODE && out->type == FILE_INODE)
+    r = file_copy(in, out, args[2]);
+  file_close(in);
+  file_close(out);
+  return (uint64_t)r;
+}
+
+// sendfile: args[0]=out fd, args[1]=in fd, args[2]=len; any readable fd to any writable one
+static uint64_t sys_sendfile(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  PCB *p = get_current_proc();
+  struct file *in = fget(p, (int)args[1]);
+  struct file *out = fget(p, (int)args[0]);
+  int64_t r = file_copy(in, out, args[2]);
+  file_close(in);
+  file_close(out);
+  return (uint64_t)r;
+}
+
+// pipe: args[0]=int fds[2], filled with the read and the write end
+static uint64_t sys_pipe(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  PCB *p = get_current_proc();
+  int *fds = (int *)args[0];
+  struct file *rf, *wf;
+  if (!fds || pipe_alloc(&rf, &wf) < 0)
+    return (uint64_t)-1;
+  int rfd = fd_install(p, rf, 0);
+  int wfd = rfd < 0 ? -1 : fd_install(p, wf, 0);
+  if (wfd < 0) {
+    if (rfd < 0)
+      file_close(rf);
+    else
+      fd_close(p, rfd);
+    file_close(wf);
+    return (uint64_t)-1;
+  }
+  fds[0] = rfd;
+  fds[1] = wfd;
+  return 0;
+}
+
+// dup: args[0]=fd; the lowest free fd now shares fd's open file (and offset)
+static uint64_t sys_dup(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  return (uint64_t)(int64_t)fd_dup(get_current_proc(), (int)args[0]);
+}
+
+// dup2: args[0]=fd, args[1]=newfd; newfd is closed first if open (e.g. stdin/stdout)
+static uint64_t sys_dup2(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  return (uint64_t)(int64_t)fd_dup2(get_current_proc(), (int)args[0], (int)args[1]);
+}
+
+// fcntl: args[0]=fd, args[1]=F_GETFD/F_SETFD, args[2]=FD_* for F_SETFD
+static uint64_t sys_fcntl(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  return (uint64_t)(int64_t)fd_fcntl(get_current_proc(), (int)args[0], (int)args[1], args[2]);
+}
+
+// poll: args[0]=struct pollfd array, args[1]=count (<= POLL_MAX), args[2]=timeout in
+// mtime ticks (0 = do not wait, < 0 = forever); returns how many fds have revents
+static uint64_t sys_poll(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  return (uint64_t)fd_poll(get_current_proc(), (struct pollfd *)args[0], (int)args[1],
+                           (int64_t)args[2]);
+}
+
+static uint64_t sys_epoll_create(uint64_t args[6], uint64_t epc) {
+  (void)args;
+  (void)epc;
+  return (uint64_t)epoll_create(get_current_proc());
+}
+
+// epoll_ctl: args[0]=epfd, args[1]=EPOLL_CTL_*, args[2]=fd, args[3]=struct epoll_event
+static uint64_t sys_epoll_ctl(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  return (uint64_t)epoll_ctl(get_current_proc(), (int)args[0], (int)args[1], (int)args[2],
+                             (const struct epoll_event *)args[3]);
+}
+
+// epoll_wait: args[0]=epfd, args[1]=events out, args[2]=max events, args[3]=timeout
+static uint64_t sys_epoll_wait(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  return (uint64_t)epoll_wait(get_current_proc(), (int)args[0], (struct epoll_event *)args[1],
+                              (int)args[2], (int64_t)args[3]);
 }
 
 // blocking read single char from UART console
 static uint64_t sys_getc(uint64_t args[6], uint64_t epc) {
   (void)args;
   (void)epc;
-  char c = uart_getc_blocking();
+  char c = uart_getc_sleep();
   return (uint64_t)(unsigned char)c;
 }
 
@@ -131,6 +299,27 @@ static uint64_t sys_trunc(uint64_t args[6], uint64_t epc) {
   return (uint64_t)r;
 }
 
+// rename: args[0]=old name, args[1]=new name (replaced if it exists)
+static uint64_t sys_rename(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  return (uint64_t)(int64_t)fs_rename((const char *)args[0], (const char *)args[1]);
+}
+
+// stat: args[0]=name, args[1]=struct stat *
+static uint64_t sys_stat(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  return (uint64_t)(int64_t)fs_stat((const char *)args[0], (struct stat *)args[1]);
+}
+
+// fstat: args[0]=fd, args[1]=struct stat *
+static uint64_t sys_fstat(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  struct file *f = fget(get_current_proc(), (int)args[0]);
+  int r = file_stat(f, (struct stat *)args[1]);
+  file_close(f);
+  return (uint64_t)(int64_t)r;
+}
+
 // simple ps: dump process list to console
 static uint64_t sys_ps(uint64_t args[6], uint64_t epc) {
   (void)args;
@@ -170,6 +359,97 @@ static uint64_t sys_kill(uint64_t args[6], uint64_t epc) {
   int r = proc_kill(pid);
   return (uint64_t)r;
 }
+// thread_create: args[0]=start routine, args[1]=its argument, args[2]=stack top or 0
+static uint64_t sys_thread_create(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  PCB *t = proc_thread_create(args[0], args[1], args[2]);
+  if (!t)
+    return (uint64_t)-1;
+  return (uint64_t)t->pid;
+}
+
+// thread_join: args[0]=tid, args[1]=where to store its return value (may be NULL)
+static uint64_t sys_thread_join(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  int r = proc_thread_join((int)args[0], (uint64_t *)args[1]);
+  return (uint64_t)r;
+}
+
+// thread_exit: args[0]=return value handed to the joiner
+static uint64_t sys_thread_exit(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  PCB *p = get_current_proc();
+  if (p)
+    p->exit_val = args[0];
+  proc_exit();
+  return 0; // not reached
+}
+
+// futex: args[0]=word address, args[1]=op, args[2]=val, args[3]=timeout (WAIT) or addr2 (REQUEUE)
+static uint64_t sys_futex(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  return (uint64_t)futex((uint32_t *)args[0], (int)args[1], (uint32_t)args[2], args[3]);
+}
+
+// sched_setattr: args[0]=pid (0 = caller), args[1]=struct sched_attr *
+static uint64_t sys_sched_setattr(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  struct sched_attr *attr = (struct sched_attr *)args[1];
+  if (!attr)
+    return (uint64_t)-1;
+  intr_off();
+  PCB *p = args[0] ? proc_find((int)args[0]) : get_current_proc();
+  int r = dl_setattr(p, attr->runtime, attr->deadline, attr->period);
+  intr_on();
+  return (uint64_t)r;
+}
+
+// sched_getattr: args[0]=pid (0 = caller), args[1]=struct sched_attr * to fill
+static uint64_t sys_sched_getattr(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  struct sched_attr *attr = (struct sched_attr *)args[1];
+  if (!attr)
+    return (uint64_t)-1;
+  intr_off();
+  PCB *p = args[0] ? proc_find((int)args[0]) : get_current_proc();
+  if (p)
+    dl_getattr(p, attr);
+  intr_on();
+  return p ? 0 : (uint64_t)-1;
+}
+
+// sched_yield: give up the CPU (a deadline task ends its job until its next period)
+static uint64_t sys_sched_yield(uint64_t args[6], uint64_t epc) {
+  (void)args;
+  (void)epc;
+  intr_off();
+  sched_yield(get_current_proc());
+  schedule();
+  return 0;
+}
+
+// sched_policy: args[0]=policy name to switch to (NULL = keep), args[1]=buffer that
+// receives the active policy name, args[2]=buffer size
+static uint64_t sys_sched_policy(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  const char *name = (const char *)args[0];
+  char *buf = (char *)args[1];
+  uint64_t len = args[2];
+  int r = 0;
+  intr_off();
+  if (name)
+    r = sched_set_policy(name);
+  if (buf && len > 0) {
+    const char *cur = sched_policy_name();
+    uint64_t i = 0;
+    for (; i + 1 < len && cur[i]; i++)
+      buf[i] = cur[i];
+    buf[i] = '\0';
+  }
+  intr_on();
+  return (uint64_t)r;
+}
+
 // suspend current process into blocked_list; never returns on success
 static uint64_t sys_suspend(uint64_t args[6], uint64_t epc) {
   (void)args;
@@ -213,7 +493,8 @@ static uint64_t sys_shutdown(uint64_t args[6], uint64_t epc) {
 static uint64_t sys_sbrk(uint64_t args[6], uint64_t epc) {
   (void)epc;
   uint64_t incr = args[0];
-  PCB *p = get_current_proc();
+  // threads grow the heap of their group leader
+  PCB *p = proc_group_leader(get_current_proc());
   if (!p)
     return (uint64_t)-1;
 
@@ -240,93 +521,221 @@ static uint64_t sys_sbrk(uint64_t args[6], uint64_t epc) {
   return old_brk;
 }
 
-// ==== exec support: map program name to linked-in user entry point ====
+// exec: args[0]=program name, args[1]=NULL-terminated argv. Replaces the caller's image:
+// on success it resumes at the program's entry with a0=argc, a1=argv instead of after
+// the ecall (SYSF_SETPC)
+static uint64_t sys_exec(uint64_t args[6], uint64_t epc) {
+  PCB *p = get_current_proc();
+  uint64_t entry;
+  struct exec_image *img;
+  if (exec_resolve((const char *)args[0], &entry, &img) < 0 ||
+      proc_exec((const char *)args[0], entry, img, (char *const *)args[1]) < 0) {
+    image_put(img);
+    // exec failed: return -1 to caller and resume after ecall
+    p->tf->sepc = epc + 4;
+    return (uint64_t)-1;
+  }
+  return p->tf->x10; // a0 = argc, set by proc_exec
+}
 
-typedef void (*exec_entry_fn)(int, char **);
+// spawn: args[0]=program name, args[1]=NULL-terminated argv, args[2]=spawn_fd_actions or NULL.
+// The child is built straight from the program image, so nothing of the caller is copied.
+static uint64_t sys_spawn(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  const char *name = (const char *)args[0];
+  char *const *argv = (char *const *)args[1];
+  const struct spawn_fd_actions *fa = (const struct spawn_fd_actions *)args[2];
+
+  // by default the child inherits the caller's fd 0/1; the actions must name open fds
+  PCB *cur = get_current_proc();
+  int in_fd = fa ? fa->stdin_fd : -1;
+  int out_fd = fa ? fa->stdout_fd : -1;
+  if ((in_fd >= 0 && !fd_get(cur, in_fd)) || (out_fd >= 0 && !fd_get(cur, out_fd)))
+    return (uint64_t)-1;
+
+  uint64_t entry;
+  struct exec_image *img;
+  if (exec_resolve(name, &entry, &img) < 0)
+    return (uint64_t)-1;
+  PCB *child = proc_spawn(name, entry, img, argv, in_fd, out_fd);
+  if (!child) {
+    image_put(img);
+    return (uint64_t)-1;
+  }
+  return (uint64_t)child->pid;
+}
+
+typedef uint64_t (*syscall_fn)(uint64_t args[6], uint64_t epc);
 
-typedef struct ExecEntry {
+struct syscall_desc {
+  syscall_fn fn;
   const char *name;
-  exec_entry_fn entry;
-} ExecEntry;
+  uint8_t nargs; // arguments shown by strace
+  uint8_t flags; // SYSF_*
+};
 
-// declare user-space entry functions that are linked into the kernel image
-extern void user_shell(void);
-extern void hello_main(int argc, char **argv);
+// handler prototypes and syscall_table[], generated from syscall.tbl
+#include "syscall_table.h"
 
-static ExecEntry exec_table[] = {
-    {"sh", (exec_entry_fn)user_shell},
-    {"hello", hello_main},
+// counters, indexed like syscall_table (the name field is filled on read)
+static struct syscall_stat syscall_stats[NR_SYSCALLS];
+
+struct strace_ring {
+  uint32_t head;  // next slot to write
+  uint32_t count; // valid entries (at most STRACE_RING_SIZE)
+  struct strace_entry e[STRACE_RING_SIZE];
 };
 
-static int exec_table_count = sizeof(exec_table) / sizeof(exec_table[0]);
+_Static_assert(sizeof(struct strace_ring) <= PAGE_SIZE, "strace ring must fit in one page");
 
-// simple strcmp implementation (to avoid depending on kernel string.h symbols here)
-static int kstrcmp(const char *a, const char *b) {
-  while (*a && *a == *b) {
-    a++;
+// log2 bucket of a latency: floor(log2(cycles)), 0 for 0 and 1
+static int hist_bucket(uint64_t cycles) {
+  int b = 0;
+  while (cycles > 1 && b < SYSCALL_HIST_BUCKETS - 1) {
+    cycles >>= 1;
     b++;
   }
-  return (int)(unsigned char)*a - (int)(unsigned char)*b;
+  return b;
 }
 
-// look up program name (args[0]) in exec_table and return entry address, or -1
-uint64_t sys_exec_lookup(uint64_t args[6]) {
-  const char *name = (const char *)args[0];
-  if (!name)
+static void syscall_account(uint64_t num, uint64_t ret, uint64_t cycles) {
+  struct syscall_stat *st = &syscall_stats[num];
+  st->count++;
+  if (ret == (uint64_t)-1)
+    st->errors++;
+  st->cycles += cycles;
+  if (cycles > st->max_cycles)
+    st->max_cycles = cycles;
+  st->hist[hist_bucket(cycles)]++;
+}
+
+static void strace_record(PCB *p, uint64_t num, uint64_t args[6], uint64_t ret,
+                          uint64_t cycles) {
+  struct strace_ring *r = p->strace;
+  struct strace_entry *e = &r->e[r->head];
+  e->nr = num;
+  for (int i = 0; i < STRACE_MAXARGS; i++)
+    e->args[i] = i < syscall_table[num].nargs ? args[i] : 0;
+  e->ret = ret;
+  e->cycles = cycles;
+  r->head = (r->head + 1) % STRACE_RING_SIZE;
+  if (r->count < STRACE_RING_SIZE)
+    r->count++;
+}
+
+void strace_release(PCB *p) {
+  if (p && p->strace) {
+    kfree(p->strace);
+    p->strace = NULL;
+  }
+}
+
+// uring_setup: args[0]=URING_SETUP_* flags; returns the shared ring page
+static uint64_t sys_uring_setup(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  return (uint64_t)uring_setup(get_current_proc(), (uint32_t)args[0]);
+}
+
+// uring_enter: args[0]=to_submit, args[1]=min_complete, args[2]=URING_ENTER_* flags
+static uint64_t sys_uring_enter(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  return (uint64_t)uring_enter(get_current_proc(), (uint32_t)args[0], (uint32_t)args[1],
+                               (uint32_t)args[2]);
+}
+
+// syscall_stats: args[0]=syscall number (-1 = reset all), args[1]=struct syscall_stat *
+static uint64_t sys_syscall_stats(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  int64_t nr = (int64_t)args[0];
+  struct syscall_stat *out = (struct syscall_stat *)args[1];
+  if (nr == -1) {
+    memset(syscall_stats, 0, sizeof(syscall_stats));
+    return 0;
+  }
+  if (nr < 0 || nr >= NR_SYSCALLS || !syscall_table[nr].fn || !out)
+    return (uint64_t)-1;
+  *out = syscall_stats[nr];
+  const char *name = syscall_table[nr].name;
+  int i = 0;
+  for (; i < SYSCALL_NAME_MAX - 1 && name[i]; i++)
+    out->name[i] = name[i];
+  out->name[i] = '\0';
+  out->nargs = syscall_table[nr].nargs;
+  out->flags = syscall_table[nr].flags;
+  return 0;
+}
+
+// strace: args[0]=pid (0 = caller), args[1]=STRACE_* op, args[2]=buffer, args[3]=max entries
+static uint64_t sys_strace(uint64_t args[6], uint64_t epc) {
+  (void)epc;
+  PCB *p = args[0] ? proc_find((int)args[0]) : get_current_proc();
+  if (!p)
     return (uint64_t)-1;
 
-  for (int i = 0; i < exec_table_count; i++) {
-    if (kstrcmp(exec_table[i].name, name) == 0) {
-      return (uint64_t)exec_table[i].entry;
+  switch (args[1]) {
+  case STRACE_OFF:
+    strace_release(p);
+    return 0;
+  case STRACE_ON:
+    if (!p->strace) {
+      p->strace = (struct strace_ring *)kalloc();
+      if (!p->strace)
+        return (uint64_t)-1;
+    }
+    memset(p->strace, 0, sizeof(struct strace_ring));
+    return 0;
+  case STRACE_READ: {
+    struct strace_entry *buf = (struct strace_entry *)args[2];
+    uint64_t max = args[3];
+    struct strace_ring *r = p->strace;
+    if (!r || !buf)
+      return (uint64_t)-1;
+    uint64_t n = 0;
+    uint32_t tail = (r->head + STRACE_RING_SIZE - r->count) % STRACE_RING_SIZE;
+    while (n < max && r->count > 0) {
+      buf[n++] = r->e[tail];
+      tail = (tail + 1) % STRACE_RING_SIZE;
+      r->count--;
     }
+    return n;
   }
-  return (uint64_t)-1;
-}
-
-uint64_t syscall_dispatch(uint64_t num, uint64_t args[6], uint64_t epc) {
-  switch (num) {
-  case SYS_GETPID:
-    return sys_getpid(args, epc);
-  case SYS_EXIT:
-    return sys_exit(args, epc);
-  case SYS_UPTIME:
-    return sys_uptime(args, epc);
-  case SYS_SLEEP:
-    return sys_sleep(args, epc);
-  case SYS_WRITE:
-    return sys_write(args, epc);
-  case SYS_OPEN:
-    return sys_open(args, epc);
-  case SYS_READ:
-    return sys_read(args, epc);
-  case SYS_CLOSE:
-    return sys_close(args, epc);
-  case SYS_KILL:
-    return sys_kill(args, epc);
-  case SYS_FORK:
-    return sys_fork(args, epc);
-  case SYS_SHUTDOWN:
-    return sys_shutdown(args, epc);
-  case SYS_WAIT:
-    return sys_wait(args, epc);
-  case SYS_SBRK:
-    return sys_sbrk(args, epc);
-  case SYS_LS:
-    return sys_ls(args, epc);
-  case SYS_GETC:
-    return sys_getc(args, epc);
-  case SYS_UNLINK:
-    return sys_unlink(args, epc);
-  case SYS_TRUNC:
-    return sys_trunc(args, epc);
-  case SYS_PS:
-    return sys_ps(args, epc);
-  case SYS_SUSPEND:
-    return sys_suspend(args, epc);
-  // SYS_EXEC is handled specially in trap.c so that it can change mepc/arguments; do not
-  // process it here.
   default:
-    /* unsupported syscall */
     return (uint64_t)-1;
   }
 }
+
+void syscall_dispatch(RegState *tf) {
+  uint64_t num = tf->x17;
+  uint64_t args[6] = {tf->x10, tf->x11, tf->x12, tf->x13, tf->x14, tf->x15};
+  uint64_t epc = tf->sepc;
+
+  if (num >= NR_SYSCALLS || !syscall_table[num].fn) {
+    /* unsupported syscall */
+    tf->x10 = (uint64_t)-1;
+    tf->sepc = epc + 4;
+    return;
+  }
+  const struct syscall_desc *sc = &syscall_table[num];
+
+  uint64_t start = read_mcycle();
+  if (sc->flags & SYSF_NORETURN)
+    syscall_account(num, 0, 0); // counted on entry, it never comes back
+
+  /* the frame lives on the caller's kernel stack, so it survives blocking syscalls */
+  uint64_t ret = sc->fn(args, epc);
+
+  tf->x10 = ret;
+  /* advance mepc to skip ecall instruction */
+  if (!(sc->flags & SYSF_SETPC))
+    tf->sepc = epc + 4;
+
+  uint64_t cycles = read_mcycle() - start;
+  syscall_account(num, ret, cycles);
+  PCB *p = get_current_proc();
+  if (p && p->strace)
+    strace_record(p, num, args, ret, cycles);
+  /* killed while inside a filesystem operation (proc_kill): leave now, never back in
+   * user mode */
+  if (p && p->killed)
+    proc_exit();
+}
@@ -15,43 +15,76 @@
 
 #include <stdint.h>
 
-/* syscall numbers */
-#define SYS_EXIT 1
-#define SYS_GETPID 2
-#define SYS_FORK 3
-#define SYS_WAIT 4
-#define SYS_SBRK 5
-#define SYS_SLEEP 6
-#define SYS_KILL 7
-#define SYS_UPTIME 8
-#define SYS_WRITE 9
-#define SYS_OPEN 10
-#define SYS_READ 11
-#define SYS_CLOSE 12
-// list root directory entries
-#define SYS_LS 13
-// read a single character from console (UART), blocking
-#define SYS_GETC 14
-// unlink (remove) a file in root directory
-#define SYS_UNLINK 15
-// exec: replace current process image with named user program
-#define SYS_EXEC 16
-// truncate file (set size to 0)
-#define SYS_TRUNC 17
-
-// list processes (ps)
-#define SYS_PS 18
-
-// shutdown / halt the whole system
-#define SYS_SHUTDOWN 19
-
-// suspend current process into blocked state (used by bg worker)
-#define SYS_SUSPEND 20
-
-/* dispatcher: num, args[6], epc -> return value */
-uint64_t syscall_dispatch(uint64_t num, uint64_t args[6], uint64_t epc);
-
-// exec helper: map program name (in args[0]) to entry address, or -1 on failure
-uint64_t sys_exec_lookup(uint64_t args[6]);
+/* syscall numbers (SYS_*, NR_SYSCALLS), generated from syscall.tbl by gen_syscalls.py */
+#include "syscall_nr.h"
+
+// spawn file actions: applied to the child before it starts (-1 = inherit the caller's)
+struct spawn_fd_actions {
+  int stdin_fd;  // caller fd that becomes the child's fd 0
+  int stdout_fd; // caller fd that becomes the child's fd 1
+};
+
+// deadline parameters and statistics, all times in mtime ticks
+struct sched_attr {
+  uint64_t runtime;      // budget per period, 0 = normal round-robin process
+  uint64_t deadline;     // relative deadline, runtime <= deadline <= period (0 = period)
+  uint64_t period;       // activation period
+  uint64_t misses;       // deadlines missed by this process (getattr only)
+  uint64_t total_misses; // deadlines missed by all deadline processes (getattr only)
+};
+
+// per-syscall statistics; latencies are in mcycle cycles, measured from entry to
+// the return to user space (so blocking syscalls include the time spent asleep)
+#define SYSCALL_NAME_MAX 16
+#define SYSCALL_HIST_BUCKETS 32
+#define SYSF_NORETURN 0x1 // does not return to the caller (exit paths)
+#define SYSF_SETPC 0x2    // handler sets the return pc itself (exec)
+#define SYSF_BLOCK 0x4    // may sleep, so its latency includes waiting
+struct syscall_stat {
+  char name[SYSCALL_NAME_MAX];
+  uint32_t nargs;
+  uint32_t flags;  // SYSF_*
+  uint64_t count;  // invocations
+  uint64_t errors; // invocations that returned -1
+  uint64_t cycles; // total latency
+  uint64_t max_cycles;
+  uint64_t hist[SYSCALL_HIST_BUCKETS]; // hist[i]: calls taking [2^i, 2^(i+1)) cycles
+};
+
+// strace ops
+#define STRACE_OFF 0  // stop tracing and drop the ring
+#define STRACE_ON 1   // start tracing into a fresh ring
+#define STRACE_READ 2 // move up to max entries (oldest first) into buf, return how many
+
+// one traced syscall; the ring (one page) keeps the newest STRACE_RING_SIZE entries
+#define STRACE_RING_SIZE 56
+#define STRACE_MAXARGS 6 // every argument a syscall can take
+struct strace_entry {
+  uint64_t nr;
+  uint64_t args[STRACE_MAXARGS]; // the syscall's nargs first, the rest 0
+  uint64_t ret;
+  uint64_t cycles;
+};
+
+struct RegisterState;
+/* dispatcher: read number and arguments from the trap frame, run the handler and
+ * store its result in the frame's a0
+ */
+void syscall_dispatch(struct RegisterState *tf);
+
+struct ProcessControlBlock;
+// free p's strace ring (process exit/reap)
+void strace_release(struct ProcessControlBlock *p);
+
+/* file I/O on behalf of p: the caller, or the owner of an io ring (see uring.h), in
+ * p's fd table. Return the syscall result (-1 on error).
+ */
+int64_t ksys_read(struct ProcessControlBlock *p, int fd, void *buf, uint64_t len);
+int64_t ksys_write(struct ProcessControlBlock *p, int fd, const void *buf, uint64_t len);
+struct iovec;
+int64_t ksys_readv(struct ProcessControlBlock *p, int fd, const struct iovec *iov, int iovcnt);
+int64_t ksys_writev(struct ProcessControlBlock *p, int fd, const struct iovec *iov, int iovcnt);
+int64_t ksys_open(struct ProcessControlBlock *p, const char *name, int flags);
+int64_t ksys_close(struct ProcessControlBlock *p, int fd);
 
 #endif /* _SYSCALL_H_ */
@@ -0,0 +1,352 @@
+/*
+ * Lrix
+ * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+ *
+ * This program is released under the terms of the GNU General Public License version 2(GPLv2).
+ * See https://opensource.org/licenses/GPL-2.0 for more information.
+ *
+ * Project homepage: https://github.com/lrisguan/Lrix
+ * Description: A scratch implemention of OS based on RISC-V
+ */
+
+#include "uring.h"
+#include "../fs/file.h"
+#include "../include/log.h"
+#include "../include/riscv.h"
+#include "../mem/kmem.h"
+#include "../proc/proc.h"
+#include "../string/string.h"
+#include "../trap/trap.h"
+#include "syscall.h"
+
+_Static_assert(sizeof(struct uring) <= PAGE_SIZE, "uring must fit in one page");
+
+// rings in the whole system (SQPOLL scans and the timer tick walk this table)
+#define URING_MAX_RINGS 16
+// pending URING_OP_SLEEP requests per ring
+#define URING_MAX_TIMEOUTS 8
+// the SQPOLL thread sleeps after finding all SQs empty for this long (mtime ticks)
+#define URING_SQPOLL_IDLE TIMER_TICK
+
+struct uring_timeout {
+  uint64_t deadline;  // mtime at which to complete, 0 = free slot
+  uint64_t user_data;
+};
+
+// kernel side of a ring, one page like the ring itself
+struct uring_ctx {
+  struct uring *ring; // shared page
+  PCB *owner;         // process the requests run for (its fd table)
+  waitqueue cq_wq;    // owner waiting in uring_enter(URING_ENTER_GETEVENTS)
+  int busy;           // SQPOLL thread is running requests of this ring
+  int dead;           // owner exited while busy: the SQPOLL thread frees it
+  uint32_t ntimeouts;
+  struct uring_timeout timeouts[URING_MAX_TIMEOUTS];
+};
+
+static struct uring_ctx *rings[URING_MAX_RINGS];
+
+static PCB *sqpoll_proc;     // the SQPOLL kernel thread, created with the first SQPOLL ring
+static waitqueue sqpoll_wq;  // where it sleeps when idle
+static int sqpoll_sleeping;
+
+static void uring_ctx_free(struct uring_ctx *ctx) {
+  kfree(ctx->ring);
+  kfree(ctx);
+}
+
+// cqes posted and not yet reaped; a bogus cq_head from user space counts as full
+static uint32_t cq_ready(struct uring *r) {
+  uint32_t n = r->cq_tail - __atomic_load_n(&r->cq_head, __ATOMIC_ACQUIRE);
+  return n > URING_CQ_ENTRIES ? URING_CQ_ENTRIES : n;
+}
+
+static void cq_post(struct uring_ctx *ctx, uint64_t user_data, int64_t res) {
+  struct uring *r = ctx->ring;
+  struct uring_cqe *cqe = &r->cqes[r->cq_tail & (URING_CQ_ENTRIES - 1)];
+  cqe->user_data = user_data;
+  cqe->res = res;
+  __atomic_store_n(&r->cq_tail, r->cq_tail + 1, __ATOMIC_RELEASE);
+  proc_wakeup(&ctx->cq_wq, -1);
+}
+
+static int64_t uring_add_timeout(struct uring_ctx *ctx, const struct uring_sqe *sqe) {
+  for (int i = 0; i < URING_MAX_TIMEOUTS; i++) {
+    struct uring_timeout *t = &ctx->timeouts[i];
+    if (t->deadline)
+      continue;
+    t->deadline = read_mtime() + sqe->len;
+    t->user_data = sqe->user_data;
+    ctx->ntimeouts++;
+    return 0;
+  }
+  return -1;
+}
+
+// open file type behind the owner's fd, FILE_NONE if fd is not open
+static int uring_fd_type(struct uring_ctx *ctx, int fd) {
+  struct file *f = fd_get(ctx->owner, fd);
+  return f ? f->type : FILE_NONE;
+}
+
+// run one request; SLEEP completes later from uring_tick
+static void uring_exec(struct uring_ctx *ctx, const struct uring_sqe *sqe) {
+  int64_t res;
+  switch (sqe->opcode) {
+  case URING_OP_NOP:
+    res = 0;
+    break;
+  case URING_OP_READ:
+  case URING_OP_WRITE:
+    // the SQPOLL thread must not sleep in a pipe or on console input for one ring
+    if (ctx->busy && (uring_fd_type(ctx, sqe->fd) == FILE_PIPE ||
+                      (sqe->opcode == URING_OP_READ &&
+                       uring_fd_type(ctx, sqe->fd) == FILE_CONSOLE))) {
+      res = -1;
+      break;
+    }
+    if (sqe->opcode == URING_OP_READ)
+      res = ksys_read(ctx->owner, sqe->fd, (void *)sqe->addr, sqe->len);
+    else
+      res = ksys_write(ctx->owner, sqe->fd, (const void *)sqe->addr, sqe->len);
+    break;
+  case URING_OP_OPEN:
+    res = ksys_open(ctx->owner, (const char *)sqe->addr, (int)sqe->len);
+    break;
+  case URING_OP_CLOSE:
+    res = ksys_close(ctx->owner, sqe->fd);
+    break;
+  case URING_OP_FSYNC:
+    res = uring_fd_type(ctx, sqe->fd) == FILE_INODE ? 0 : -1;
+    break;
+  case URING_OP_SLEEP:
+    if (sqe->len && uring_add_timeout(ctx, sqe) == 0)
+      return;
+    res = sqe->len ? -1 : 0;
+    break;
+  default:
+    res = -1;
+    break;
+  }
+  cq_post(ctx, sqe->user_data, res);
+}
+
+/* consume up to max sqes. A request is only taken while its completion is sure to
+ * fit in the CQ (pending sleeps hold a slot each), so cqes are never dropped; the
+ * rest stays queued until user space reaps.
+ */
+static uint32_t uring_consume(struct uring_ctx *ctx, uint32_t max) {
+  struct uring *r = ctx->ring;
+  uint32_t n = 0;
+  while (n < max) {
+    uint32_t tail = __atomic_load_n(&r->sq_tail, __ATOMIC_ACQUIRE);
+    if (r->sq_head == tail || tail - r->sq_head > URING_SQ_ENTRIES)
+      break;
+    if (cq_ready(r) + ctx->ntimeouts >= URING_CQ_ENTRIES)
+      break;
+    // copy first: the slot belongs to user space again once sq_head moves
+    struct uring_sqe sqe = r->sqes[r->sq_head & (URING_SQ_ENTRIES - 1)];
+    __atomic_store_n(&r->sq_head, r->sq_head + 1, __ATOMIC_RELEASE);
+    uring_exec(ctx, &sqe);
+    n++;
+  }
+  return n;
+}
+
+static int sq_pending(struct uring *r) {
+  return r->sq_head != __atomic_load_n(&r->sq_tail, __ATOMIC_ACQUIRE);
+}
+
+/* The SQPOLL thread is a kernel process: like any process it runs with mscratch
+ * holding its kernel stack top, so interrupts land there. Before calling into the
+ * scheduler it must look like kernel code to the trap entry (mscratch 0), and it
+ * restores its own value once it runs again.
+ */
+static void sqpoll_enter_kernel(void) {
+  intr_off();
+  asm volatile("csrw mscratch, zero");
+}
+
+static void sqpoll_leave_kernel(PCB *self) {
+  intr_off();
+  asm volatile("csrw mscratch, %0" : : "r"(self->kstacktop));
+  intr_on();
+}
+
+// scan all SQPOLL rings once; returns how many sqes were consumed
+static uint32_t sqpoll_scan(void) {
+  uint32_t n = 0;
+  for (int i = 0; i < URING_MAX_RINGS; i++) {
+    struct uring_ctx *ctx = rings[i];
+    if (!ctx || !(ctx->ring->setup_flags & URING_SETUP_SQPOLL))
+      continue;
+    ctx->busy = 1;
+    n += uring_consume(ctx, URING_SQ_ENTRIES);
+    ctx->busy = 0;
+    if (ctx->dead)
+      uring_ctx_free(ctx);
+  }
+  return n;
+}
+
+static void sqpoll_set_need_wakeup(int on) {
+  for (int i = 0; i < URING_MAX_RINGS; i++) {
+    if (!rings[i] || !(rings[i]->ring->setup_flags & URING_SETUP_SQPOLL))
+      continue;
+    if (on)
+      __atomic_or_fetch(&rings[i]->ring->sq_flags, URING_SQ_NEED_WAKEUP, __ATOMIC_RELEASE);
+    else
+      __atomic_and_fetch(&rings[i]->ring->sq_flags, ~URING_SQ_NEED_WAKEUP, __ATOMIC_RELEASE);
+  }
+}
+
+static int sqpoll_any_pending(void) {
+  for (int i = 0; i < URING_MAX_RINGS; i++)
+    if (rings[i] && (rings[i]->ring->setup_flags & URING_SETUP_SQPOLL) &&
+        sq_pending(rings[i]->ring))
+      return 1;
+  return 0;
+}
+
+/* SQPOLL thread: keep draining the SQs, yielding the CPU between empty scans. After
+ * URING_SQPOLL_IDLE without work it flags every ring URING_SQ_NEED_WAKEUP and sleeps
+ * until uring_enter(URING_ENTER_SQ_WAKEUP).
+ */
+static void uring_sqpoll_main(void) {
+  PCB *self = get_current_proc();
+  uint64_t last_work = read_mtime();
+  while (1) {
+    intr_off();
+    if (sqpoll_scan()) {
+      last_work = read_mtime();
+      intr_on();
+      continue;
+    }
+    if (read_mtime() - last_work < URING_SQPOLL_IDLE) {
+      sqpoll_enter_kernel();
+      schedule();
+      sqpoll_leave_kernel(self);
+      continue;
+    }
+
+    sqpoll_set_need_wakeup(1);
+    // a submission that raced with setting the flag did not see it: look once more
+    if (!sqpoll_any_pending()) {
+      sqpoll_enter_kernel();
+      sqpoll_sleeping = 1;
+      proc_sleep_on(&sqpoll_wq, 0);
+      sqpoll_leave_kernel(self);
+    }
+    intr_off();
+    sqpoll_sleeping = 0;
+    sqpoll_set_need_wakeup(0);
+    last_work = read_mtime();
+    intr_on();
+  }
+}
+
+struct uring *uring_setup(PCB *p, uint32_t flags) {
+  if (!p || (flags & ~URING_SETUP_SQPOLL))
+    return NULL;
+  if (p->uring)
+    return p->uring->ring->setup_flags == flags ? p->uring->ring : NULL;
+
+  int slot = -1;
+  for (int i = 0; i < URING_MAX_RINGS && slot < 0; i++)
+    if (!rings[i])
+      slot = i;
+  if (slot < 0)
+    return NULL;
+
+  if ((flags & URING_SETUP_SQPOLL) && !sqpoll_proc) {
+    sqpoll_proc = proc_create("sqpoll", (uint64_t)uring_sqpoll_main, 0);
+    if (!sqpoll_proc)
+      return NULL;
+    // it may only schedule through sqpoll_enter_kernel: disk I/O polls instead of sleeping
+    sqpoll_proc->no_sleep = 1;
+    printk(BLUE "[uring]: \tSQPOLL thread started pid=%d" RESET "\n", sqpoll_proc->pid);
+  }
+
+  struct uring_ctx *ctx = (struct uring_ctx *)kalloc();
+  struct uring *r = (struct uring *)kalloc();
+  if (!ctx || !r) {
+    if (ctx)
+      kfree(ctx);
+    if (r)
+      kfree(r);
+    return NULL;
+  }
+  memset(ctx, 0, sizeof(*ctx));
+  memset(r, 0, sizeof(*r));
+  r->setup_flags = flags;
+  ctx->ring = r;
+  ctx->owner = p;
+  p->uring = ctx;
+  rings[slot] = ctx;
+  return r;
+}
+
+int64_t uring_enter(PCB *p, uint32_t to_submit, uint32_t min_complete, uint32_t flags) {
+  struct uring_ctx *ctx = p ? p->uring : NULL;
+  if (!ctx)
+    return -1;
+  struct uring *r = ctx->ring;
+  int sqpoll = r->setup_flags & URING_SETUP_SQPOLL;
+
+  int64_t submitted = 0;
+  if (!sqpoll)
+    submitted = uring_consume(ctx, to_submit);
+  else if ((flags & URING_ENTER_SQ_WAKEUP) && sqpoll_sleeping)
+    proc_wakeup(&sqpoll_wq, 1);
+
+  if (!(flags & URING_ENTER_GETEVENTS))
+    return submitted;
+  if (min_complete > URING_CQ_ENTRIES)
+    min_complete = URING_CQ_ENTRIES;
+
+  intr_off();
+  while (cq_ready(r) < min_complete) {
+    // only wait for something that is on its way: a pending sleep, or queued sqes
+    // the SQPOLL thread will pick up
+    if (!ctx->ntimeouts && !(sqpoll && sq_pending(r)))
+      break;
+    if (sqpoll && sqpoll_sleeping)
+      proc_wakeup(&sqpoll_wq, 1);
+    proc_sleep_on(&ctx->cq_wq, 0);
+    intr_off();
+  }
+  intr_on();
+  return submitted;
+}
+
+void uring_release(PCB *p) {
+  if (!p || !p->uring)
+    return;
+  struct uring_ctx *ctx = p->uring;
+  p->uring = NULL;
+  for (int i = 0; i < URING_MAX_RINGS; i++)
+    if (rings[i] == ctx)
+      rings[i] = NULL;
+  ctx->owner = NULL;
+  if (ctx->busy)
+    ctx->dead = 1;
+  else
+    uring_ctx_free(ctx);
+}
+
+void uring_tick(void) {
+  uint64_t now = read_mtime();
+  for (int i = 0; i < URING_MAX_RINGS; i++) {
+    struct uring_ctx *ctx = rings[i];
+    if (!ctx || !ctx->ntimeouts)
+      continue;
+    for (int j = 0; j < URING_MAX_TIMEOUTS; j++) {
+      struct uring_timeout *t = &ctx->timeouts[j];
+      if (!t->deadline || now < t->deadline)
+        continue;
+      t->deadline = 0;
+      ctx->ntimeouts--;
+      cq_post(ctx, t->user_data, 0);
+    }
+  }
+}
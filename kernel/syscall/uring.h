@@ -0,0 +1,91 @@
+/*
+ * Lrix
+ * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+ *
+ * This program is released under the terms of the GNU General Public License version 2(GPLv2).
+ * See https://opensource.org/licenses/GPL-2.0 for more information.
+ *
+ * Project homepage: https://github.com/lrisguan/Lrix
+ * Description: A scratch implemention of OS based on RISC-V
+ */
+
+// uring.h - batched asynchronous syscalls through a ring page shared with user space
+//
+// uring_setup() gives the process one page holding a submission queue (SQ) and a
+// completion queue (CQ). User space fills sqes and advances sq_tail; the kernel consumes
+// them on uring_enter() (or, with URING_SETUP_SQPOLL, from a kernel thread without any
+// ecall) and posts one cqe per request. Heads and tails run freely, the slot of a
+// position is pos & (ENTRIES - 1). Both sides publish with release stores and read the
+// other side's index with acquire loads.
+
+#ifndef _URING_H_
+#define _URING_H_
+
+#include <stdint.h>
+
+#define URING_SQ_ENTRIES 64 // powers of two
+#define URING_CQ_ENTRIES 64
+
+// uring_setup flags
+#define URING_SETUP_SQPOLL 0x1 // a kernel thread polls the SQ, submission needs no ecall
+
+// sq_flags, set by the kernel
+#define URING_SQ_NEED_WAKEUP 0x1 // SQPOLL thread went to sleep: uring_enter(URING_ENTER_SQ_WAKEUP)
+
+// uring_enter flags
+#define URING_ENTER_GETEVENTS 0x1 // wait until min_complete cqes are available
+#define URING_ENTER_SQ_WAKEUP 0x2 // wake the SQPOLL thread
+
+// opcodes; res is what the matching syscall would return
+#define URING_OP_NOP 0
+#define URING_OP_READ 1  // fd, addr = buffer, len
+#define URING_OP_WRITE 2 // fd, addr = buffer, len
+#define URING_OP_OPEN 3  // addr = name, len = open flags (O_*); res = fd
+#define URING_OP_CLOSE 4 // fd
+#define URING_OP_FSYNC 5 // fd; writes are synchronous, so this only validates fd
+#define URING_OP_SLEEP 6 // len = mtime ticks; completes asynchronously after that time
+
+struct uring_sqe {
+  uint8_t opcode;     // URING_OP_*
+  uint8_t flags;      // reserved, 0
+  uint16_t pad;
+  int32_t fd;
+  uint64_t addr;
+  uint64_t len;
+  uint64_t user_data; // copied into the completion
+};
+
+struct uring_cqe {
+  uint64_t user_data;
+  int64_t res;
+};
+
+// the shared page
+struct uring {
+  uint32_t sq_head;     // next sqe the kernel consumes (kernel-owned)
+  uint32_t sq_tail;     // one past the last queued sqe (user-owned)
+  uint32_t cq_head;     // next cqe to reap (user-owned)
+  uint32_t cq_tail;     // one past the last posted cqe (kernel-owned)
+  uint32_t sq_flags;    // URING_SQ_*
+  uint32_t setup_flags; // URING_SETUP_*
+  uint32_t sq_prepared; // user space: end of the sqes filled but not yet in sq_tail
+  uint32_t pad;
+  struct uring_sqe sqes[URING_SQ_ENTRIES];
+  struct uring_cqe cqes[URING_CQ_ENTRIES];
+};
+
+struct ProcessControlBlock;
+
+// p's ring, created on first use (one per process); returns the shared page, or NULL
+// if p already has a ring with other flags or memory is short
+struct uring *uring_setup(struct ProcessControlBlock *p, uint32_t flags);
+// submit up to to_submit sqes, then wait for min_complete cqes if URING_ENTER_GETEVENTS;
+// returns the number of sqes consumed, or -1 if p has no ring
+int64_t uring_enter(struct ProcessControlBlock *p, uint32_t to_submit, uint32_t min_complete,
+                    uint32_t flags);
+// free p's ring (process exit/reap)
+void uring_release(struct ProcessControlBlock *p);
+// timer tick: complete URING_OP_SLEEP requests whose time has come
+void uring_tick(void);
+
+#endif /* _URING_H_ */
@@ -0,0 +1,44 @@
+/*
+ * Lrix
+ * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+ *
+ * This program is released under the terms of the GNU General Public License version 2(GPLv2).
+ * See https://opensource.org/licenses/GPL-2.0 for more information.
+ *
+ * Project homepage: https://github.com/lrisguan/Lrix
+ * Description: A scratch implemention of OS based on RISC-V
+ */
+
+// vclock.h - clock data page for reading the time without a syscall
+//
+// sys_uptime() traps just to load CLINT_MTIME. Instead, sys_vclock() hands out (once)
+// a read-only page with the timebase and a tick-to-nanosecond conversion; the user
+// helpers (usr/uclock.c) then read the time CSR, which mirrors mtime, and convert it
+// themselves: no ecall per timestamp.
+
+#ifndef _VCLOCK_H_
+#define _VCLOCK_H_
+
+#include <stdint.h>
+
+#define VCLOCK_VERSION 1
+
+struct vclock {
+  uint32_t version; // VCLOCK_VERSION
+  uint32_t shift;
+  uint64_t freq;    // timebase: mtime / time CSR ticks per second
+  uint64_t mult;    // ns = (ticks * mult) >> shift, with a 128-bit product
+};
+
+#define NSEC_PER_SEC 1000000000ULL
+
+struct timespec {
+  int64_t tv_sec;
+  int64_t tv_nsec;
+};
+
+// clocks for uclock_gettime; mtime starts at 0 on reset, so both count from boot
+#define CLOCK_MONOTONIC 1
+#define CLOCK_BOOTTIME 7
+
+#endif /* _VCLOCK_H_ */
@@ -27,10 +27,14 @@ void plic_init(void) {
     *(uint32_t *)(PLIC_ENABLE + hart * 0x80) |= (1 << irq);
   }
 
+  // UART receive interrupt, so console readers can sleep instead of polling
+  *(uint32_t *)(PLIC_PRIORITY + UART_IRQ * 4) = 1;
+  *(uint32_t *)(PLIC_ENABLE + hart * 0x80) |= (1 << UART_IRQ);
+
   // 3. Set threshold = 0 (allow all interrupts with priority > 0)
   *(uint32_t *)PLIC_THRESHOLD(hart) = 0;
 
-  printk(BLUE "[INFO]: \tplic init done, enabled IRQs 1-8" RESET "\n");
+  printk(BLUE "[INFO]: \tplic init done, enabled IRQs 1-8 and UART" RESET "\n");
 }
 
 // Helper: tell PLIC we are claiming an interrupt (start handling)
@@ -12,6 +12,7 @@
 #ifndef _TRAP_H_
 #define _TRAP_H_
 
+#include "../include/types.h"
 #include <stdint.h>
 
 /* Control trap printing: set to 1 for debug (verbose) mode, 0 for silent mode.
@@ -21,8 +22,19 @@
 #define TRAP_DEBUG 0
 #endif
 
+/* timer interrupt interval (round-robin time slice) in mtime ticks */
+#define TIMER_TICK 1000000ULL
+
 // unsigned long read_csr(const char *name);
 void trap_init(void);
-void trap_handler_c(uint64_t *tf);
+void trap_handler_c(RegState *tf);
+/* interrupt handlers, entered from their vectored stubs in trapentry.S */
+void software_interrupt(void);
+void timer_interrupt(void);
+void external_interrupt(void);
+/* ecall handler, entered directly from trapentry.S */
+void trap_syscall(RegState *tf);
+/* program the next timer interrupt 'interval' mtime ticks from now */
+void set_next_timer(uint64_t interval);
 
 #endif /* _TRAP_H_ */
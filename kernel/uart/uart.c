@@ -12,9 +12,11 @@
 // uart.c - printk implementation (QEMU virt / 16550 UART)
 
 #include "uart.h"
+#include "../fs/poll.h"
 #include "../include/log.h"
 #include "../include/riscv.h"
 #include "../include/types.h"
+#include "../proc/proc.h"
 #include <stdarg.h>
 #include <stdint.h>
 
@@ -30,6 +32,13 @@
 #define UART_DLL (UART_BASE + 0x00) // Divisor Latch Low (when LCR[7]=1)
 #define UART_DLM (UART_BASE + 0x01) // Divisor Latch High (when LCR[7]=1)
 
+// received characters, filled by the RX interrupt and drained by readers
+#define UART_RX_BUF 128
+static char rx_buf[UART_RX_BUF];
+static uint32_t rx_head = 0; // next slot written by uart_intr
+static uint32_t rx_tail = 0; // next slot read by uart_getc
+static waitqueue rx_wq;      // processes sleeping in uart_getc_sleep
+
 // Wait and write character to THR
 static void uart_putc(char c) {
   volatile unsigned char *lsr = (volatile unsigned char *)UART_LSR;
@@ -48,6 +57,10 @@ char uart_getc(void) {
   volatile unsigned char *rbr = (volatile unsigned char *)UART_RBR;
   volatile unsigned char *lsr = (volatile unsigned char *)UART_LSR;
 
+  // characters already taken from the device by the RX interrupt come first
+  if (rx_tail != rx_head)
+    return rx_buf[rx_tail++ % UART_RX_BUF];
+
   if (*lsr & 0x01) { // Data Ready
     return (char)(*rbr);
   }
@@ -59,6 +72,8 @@ void uart_init(void) {
   volatile unsigned char *lcr = (volatile unsigned char *)UART_LCR;
   // Set 8 bits, no parity, 1 stop (0x03)
   *lcr = 0x03;
+  // Interrupt on received data (IER bit0), delivered as PLIC IRQ UART_IRQ
+  *(volatile unsigned char *)UART_IER = 0x01;
   // INFO("waiting for uart init...");
   // SUCCESS("uart init success");
 }
@@ -82,6 +97,44 @@ char uart_getc_blocking(void) {
   return c;
 }
 
+/* RX interrupt: move every received character into rx_buf and wake the readers.
+ * Returns the number of characters received.
+ */
+int uart_intr(void) {
+  volatile unsigned char *rbr = (volatile unsigned char *)UART_RBR;
+  volatile unsigned char *lsr = (volatile unsigned char *)UART_LSR;
+  int n = 0;
+
+  while (*lsr & 0x01) {
+    char c = (char)*rbr;
+    // drop input when the buffer is full rather than overwrite unread input
+    if (rx_head - rx_tail < UART_RX_BUF)
+      rx_buf[rx_head++ % UART_RX_BUF] = c;
+    n++;
+  }
+  if (n)
+    proc_wakeup(&rx_wq, -1);
+  return n;
+}
+
+/* Read one char, sleeping until the RX interrupt delivers input instead of
+ * spinning, so that other processes run while e.g. the shell waits for a key.
+ */
+char uart_getc_sleep(void) {
+  for (;;) {
+    intr_off();
+    char c = uart_getc();
+    if (c)
+      return c;
+    proc_sleep_on(&rx_wq, 0);
+  }
+}
+
+int uart_poll(struct poll_table *pt) {
+  poll_wait(pt, &rx_wq);
+  return rx_tail != rx_head || (*(volatile unsigned char *)UART_LSR & 0x01);
+}
+
 /*
  * Added: Read and echo characters
  * Only by calling this function to read input can the user's keystrokes be seen in the terminal.
@@ -24,6 +24,20 @@ char uart_getc_blocking(void);
 // non-blocking read one character from UART; returns 0 if no data
 char uart_getc(void);
 
+// read one character, sleeping (process context) until input arrives
+char uart_getc_sleep(void);
+
+struct poll_table;
+// console input readiness for poll: 1 if a character can be read without sleeping;
+// registers the poller on the RX wait queue through pt
+int uart_poll(struct poll_table *pt);
+
+// PLIC interrupt source of the UART on QEMU virt
+#define UART_IRQ 10
+
+// RX interrupt handler: buffer input and wake readers; returns chars received
+int uart_intr(void);
+
 // read a line into buf (NUL-terminated), return length (without NUL)
 int uart_getline(char *buf, int maxlen);
 
@@ -15,14 +15,11 @@
 #include "user.h"
 
 // ---- basic user helpers ----
-// Current output target: -1 means stdout (fd=1), otherwise a specific fd (for pipe redirection)
-static int shell_out_fd = -1;
-
+// Output goes to fd 1, which the kernel redirects to a pipe inside a pipeline
 static void uwrite_buf(const char *s, int len) {
   if (!s || len <= 0)
     return;
-  int fd = (shell_out_fd >= 0) ? shell_out_fd : 1;
-  sys_write(fd, s, (uint64_t)len);
+  sys_write(1, s, (uint64_t)len);
 }
 
 static void uputs(const char *s) {
@@ -85,14 +82,11 @@ static int parse_args(char *line, char *argv[], int max_args) {
       break;
     *p++ = '\0';
   }
+  // argv is NULL-terminated so it can be handed to spawn as-is
+  argv[argc] = 0;
   return argc;
 }
 
-// ---- simple pipeline support ----
-
-int pipe_input_active = 0;
-const char *pipe_input_name = "__pipe.tmp";
-
 static char *trim_spaces(char *s) {
   while (*s == ' ' || *s == '\t')
     s++;
@@ -116,8 +110,8 @@ static void cmd_echo(int argc, char *argv[]) {
 }
 
 static void cmd_ls(void) {
-  struct dirent ents[FS_MAX_FILES];
-  int n = sys_ls(ents, FS_MAX_FILES);
+  struct dirent ents[NINODE];
+  int n = sys_ls(ents, NINODE);
   if (n < 0) {
     uputs("ls: error\n");
     return;
@@ -130,32 +124,28 @@ static void cmd_ls(void) {
   }
 }
 
-static void cmd_cat(int argc, char *argv[]) {
-  extern int pipe_input_active;
-  extern const char *pipe_input_name;
+// bytes asked for per sendfile/copy_file_range call; the kernel works through it a
+// block at a time and returns early at end of file
+#define COPY_CHUNK (64 * 1024)
 
-  int fd;
-  if (argc < 2) {
-    if (!pipe_input_active) {
-      uputs("cat: missing file name\n");
+static void cmd_cat(int argc, char *argv[]) {
+  // without a file name, copy stdin until end of file (^D on the console)
+  int fd = 0;
+  if (argc >= 2) {
+    fd = sys_open(argv[1], 0);
+    if (fd < 0) {
+      uputs("cat: cannot open file\n");
       return;
     }
-    fd = sys_open(pipe_input_name, 0);
-  } else {
-    fd = sys_open(argv[1], 0);
-  }
-  if (fd < 0) {
-    uputs("cat: cannot open file\n");
-    return;
-  }
-  char buf[128];
-  while (1) {
-    long r = sys_read(fd, buf, sizeof(buf));
-    if (r <= 0)
-      break;
-    uwrite_buf(buf, (int)r);
   }
-  sys_close(fd);
+  // the kernel moves the data to stdout itself, no bounce through a user buffer
+  long r;
+  while ((r = sys_sendfile(1, fd, COPY_CHUNK)) > 0)
+    ;
+  if (fd != 0)
+    sys_close(fd);
+  else if (r < 0)
+    uputs("cat: missing file name\n");
 }
 
 static void cmd_help(void) {
@@ -166,6 +156,8 @@ static void cmd_help(void) {
   uputs("  touch F   - create file if not exists\n");
   uputs("  rm F      - remove file\n");
   uputs("  mv A B    - move/rename file A to B\n");
+  uputs("  cp A B    - copy file A to B\n");
+  uputs("  stat F    - show size, blocks, links and inode of file F\n");
   uputs("  pwd       - print current directory (always / in flat fs)\n");
   uputs("  mkdir D   - not supported (flat fs)\n");
   uputs("  rmdir D   - not supported (flat fs)\n");
@@ -173,13 +165,186 @@ static void cmd_help(void) {
   uputs("  read F    - read and print file F\n");
   uputs("  fork      - test fork() syscall\n");
   uputs("  bg        - create a simple background worker process\n");
+  uputs("  thread    - test thread_create()/thread_join() syscalls\n");
+  uputs("  rt        - run a periodic deadline task and report its misses\n");
+  uputs("  sched [P] - show or set the scheduling policy (rr, mlfq)\n");
+  uputs("  sysstat   - per-syscall counts and latency histograms ('reset' to clear)\n");
+  uputs("  strace X  - syscall trace: on|off|show [PID]\n");
   uputs("  kill PID  - kill process by pid\n");
   uputs("  ps        - list processes\n");
+  uputs("  uptime    - time since boot\n");
   uputs("  help      - show this message\n");
   uputs("  exit      - shutdown system\n");
   uputs("  halt      - shutdown whole system\n");
 }
 
+// shared by the 'thread' test: both workers update it through the common heap/data
+static volatile int thread_test_counter = 0;
+static umutex_t thread_test_lock;
+
+// print an unsigned decimal number
+static void uput_dec(uint64_t n) {
+  char tmp[24];
+  int t = 0;
+  do {
+    tmp[t++] = (char)('0' + (n % 10));
+    n /= 10;
+  } while (n > 0);
+  while (t > 0)
+    uputc(tmp[--t]);
+}
+
+// print a number in hex with 0x prefix
+static void uput_hex(uint64_t n) {
+  char tmp[16];
+  int t = 0;
+  do {
+    tmp[t++] = "0123456789abcdef"[n & 0xF];
+    n >>= 4;
+  } while (n > 0);
+  uputs("0x");
+  while (t > 0)
+    uputc(tmp[--t]);
+}
+
+// parse a non-negative decimal number, -1 if s is not one
+static int parse_uint(const char *s) {
+  int v = 0;
+  if (!*s)
+    return -1;
+  for (; *s; s++) {
+    if (*s < '0' || *s > '9')
+      return -1;
+    v = v * 10 + (*s - '0');
+  }
+  return v;
+}
+
+// sysstat [reset]: per-syscall counts, average/max latency and log2 histogram
+static void cmd_sysstat(int argc, char *argv[]) {
+  if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+    sys_syscall_stats(-1, 0);
+    return;
+  }
+  struct syscall_stat st;
+  for (int nr = 0; nr < NR_SYSCALLS; nr++) {
+    if (sys_syscall_stats(nr, &st) < 0 || st.count == 0)
+      continue;
+    uputs(st.name);
+    uputs(": calls=");
+    uput_dec(st.count);
+    uputs(" errors=");
+    uput_dec(st.errors);
+    uputs(" avg=");
+    uput_dec(st.cycles / st.count);
+    uputs(" max=");
+    uput_dec(st.max_cycles);
+    uputs(" cycles\n   ");
+    for (int b = 0; b < SYSCALL_HIST_BUCKETS; b++) {
+      if (!st.hist[b])
+        continue;
+      uputs(" 2^");
+      uput_dec((uint64_t)b);
+      uputc(':');
+      uput_dec(st.hist[b]);
+    }
+    uputc('\n');
+  }
+}
+
+// stat FILE: metadata from the kernel's inode cache
+static void cmd_stat(int argc, char *argv[]) {
+  struct stat st;
+  if (argc < 2) {
+    uputs("stat: missing file name\n");
+    return;
+  }
+  if (sys_stat(argv[1], &st) < 0) {
+    uputs("stat: no such file\n");
+    return;
+  }
+  uputs(argv[1]);
+  uputs(st.type == T_DIR ? ": dir" : ": file");
+  uputs(" size=");
+  uput_dec(st.size);
+  uputs(" blocks=");
+  uput_dec(st.blocks);
+  uputs(" nlink=");
+  uput_dec(st.nlink);
+  uputs(" inode=");
+  uput_dec(st.ino);
+  uputc('\n');
+}
+
+// uptime: time since boot, from the clock page without entering the kernel
+static void cmd_uptime(void) {
+  struct timespec ts;
+  uclock_gettime(CLOCK_BOOTTIME, &ts);
+  uputs("up ");
+  uput_dec((uint64_t)ts.tv_sec);
+  uputc('.');
+  uint64_t ms = (uint64_t)ts.tv_nsec / 1000000;
+  uputc((char)('0' + ms / 100));
+  uputc((char)('0' + ms / 10 % 10));
+  uputc((char)('0' + ms % 10));
+  uputs(" s\n");
+}
+
+// strace on|off|show [PID]: trace syscalls of PID (default: this shell)
+static void cmd_strace(int argc, char *argv[]) {
+  int pid = argc > 2 ? parse_uint(argv[2]) : 0;
+  if (argc < 2 || pid < 0) {
+    uputs("strace: usage: strace on|off|show [PID]\n");
+    return;
+  }
+  if (strcmp(argv[1], "on") == 0 || strcmp(argv[1], "off") == 0) {
+    if (sys_strace(pid, argv[1][1] == 'n' ? STRACE_ON : STRACE_OFF, 0, 0) < 0)
+      uputs("strace: no such process or out of memory\n");
+    return;
+  }
+  if (strcmp(argv[1], "show") != 0) {
+    uputs("strace: usage: strace on|off|show [PID]\n");
+    return;
+  }
+
+  struct strace_entry ent[8];
+  struct syscall_stat st;
+  long n;
+  while ((n = sys_strace(pid, STRACE_READ, ent, 8)) > 0) {
+    for (long i = 0; i < n; i++) {
+      if (sys_syscall_stats((int)ent[i].nr, &st) == 0)
+        uputs(st.name);
+      else
+        uput_dec(ent[i].nr);
+      uputc('(');
+      for (uint32_t a = 0; a < st.nargs && a < STRACE_MAXARGS; a++) {
+        if (a)
+          uputs(", ");
+        uput_hex(ent[i].args[a]);
+      }
+      uputs(") = ");
+      if (ent[i].ret == (uint64_t)-1)
+        uputs("-1");
+      else
+        uput_dec(ent[i].ret);
+      uputs("  [");
+      uput_dec(ent[i].cycles);
+      uputs(" cycles]\n");
+    }
+  }
+  if (n < 0)
+    uputs("strace: not tracing\n");
+}
+
+static void *thread_test_worker(void *arg) {
+  (void)arg;
+  umutex_lock(&thread_test_lock);
+  thread_test_counter++;
+  umutex_unlock(&thread_test_lock);
+  uputs("[thread] hello from worker thread\n");
+  return (void *)(uint64_t)thread_test_counter;
+}
+
 static void execute(int argc, char *argv[]) {
   if (argc == 0)
     return;
@@ -200,6 +365,8 @@ static void execute(int argc, char *argv[]) {
     cmd_cat(argc, argv);
   } else if (strcmp(argv[0], "ps") == 0) {
     sys_ps();
+  } else if (strcmp(argv[0], "uptime") == 0) {
+    cmd_uptime();
   } else if (strcmp(argv[0], "touch") == 0) {
     if (argc < 2) {
       uputs("touch: missing file name\n");
@@ -207,7 +374,7 @@ static void execute(int argc, char *argv[]) {
       // if exists, just open and close; if not, create
       int fd = sys_open(argv[1], 0);
       if (fd < 0)
-        fd = sys_open(argv[1], 1);
+        fd = sys_open(argv[1], O_CREATE);
       if (fd < 0)
         uputs("touch: failed\n");
       else
@@ -226,31 +393,32 @@ static void execute(int argc, char *argv[]) {
     } else if (strcmp(argv[1], argv[2]) == 0) {
       // nothing to do if source and destination are the same
       return;
+    } else if (sys_rename(argv[1], argv[2]) < 0) {
+      // only the directory entry changes: no data is copied
+      uputs("mv: cannot move file\n");
+    }
+  } else if (strcmp(argv[0], "cp") == 0) {
+    if (argc < 3) {
+      uputs("cp: usage: cp SRC DST\n");
+    } else if (strcmp(argv[1], argv[2]) == 0) {
+      uputs("cp: source and destination are the same file\n");
     } else {
       int srcfd = sys_open(argv[1], 0);
       if (srcfd < 0) {
-        uputs("mv: cannot open source file\n");
+        uputs("cp: cannot open source file\n");
       } else {
         // prepare destination: if it exists, remove it, then create a new file
         (void)sys_unlink(argv[2]);
-        int dstfd = sys_open(argv[2], 1);
+        int dstfd = sys_open(argv[2], O_CREATE);
         if (dstfd < 0) {
-          uputs("mv: cannot open destination file\n");
-          sys_close(srcfd);
+          uputs("cp: cannot open destination file\n");
         } else {
-          char buf[128];
-          while (1) {
-            long r = sys_read(srcfd, buf, sizeof(buf));
-            if (r <= 0)
-              break;
-            sys_write(dstfd, buf, (uint64_t)r);
-          }
-          sys_close(srcfd);
+          // block-by-block inside the kernel
+          while (sys_copy_file_range(srcfd, dstfd, COPY_CHUNK) > 0)
+            ;
           sys_close(dstfd);
-          if (sys_unlink(argv[1]) < 0) {
-            uputs("mv: warning: failed to remove source\n");
-          }
         }
+        sys_close(srcfd);
       }
     }
   } else if (strcmp(argv[0], "pwd") == 0) {
@@ -261,9 +429,7 @@ static void execute(int argc, char *argv[]) {
   } else if (strcmp(argv[0], "rmdir") == 0) {
     uputs("rmdir: directories are not supported (flat filesystem)\n");
   } else if (strcmp(argv[0], "write") == 0) {
-    extern int pipe_input_active;
-    extern const char *pipe_input_name;
-    if (argc < 3 && !(argc == 2 && pipe_input_active)) {
+    if (argc < 2) {
       uputs("write: usage: write FILE TEXT...\n");
     } else if (argc >= 3) {
       // concatenate all args after filename with spaces (no libc strcat)
@@ -293,40 +459,25 @@ static void execute(int argc, char *argv[]) {
       }
       int fd = sys_open(argv[1], 0);
       if (fd < 0)
-        fd = sys_open(argv[1], 1);
+        fd = sys_open(argv[1], O_CREATE);
       if (fd < 0) {
         uputs("write: cannot open file\n");
       } else {
         sys_write(fd, buf, strlen(buf));
         sys_close(fd);
       }
-    } else { // argc == 2 && pipe_input_active: read from pipe temp file and write into target
-      char buf[256];
-      int in = sys_open(pipe_input_name, 0);
-      if (in < 0) {
-        uputs("write: cannot open pipe input\n");
-        return;
-      }
-      long r = sys_read(in, buf, sizeof(buf) - 1);
-      sys_close(in);
-      if (r <= 0) {
-        uputs("write: empty pipe input\n");
-        return;
-      }
-      buf[r] = '\0';
-
-      if (sys_trunc(argv[1]) < 0) {
-        // ignore failure; file may not exist yet
-      }
+    } else { // argc == 2: copy stdin into the target, until ^D on the console
+      (void)sys_trunc(argv[1]); // may not exist yet
       int fd = sys_open(argv[1], 0);
       if (fd < 0)
-        fd = sys_open(argv[1], 1);
+        fd = sys_open(argv[1], O_CREATE);
       if (fd < 0) {
         uputs("write: cannot open file\n");
-      } else {
-        sys_write(fd, buf, (uint64_t)r);
-        sys_close(fd);
+        return;
       }
+      while (sys_sendfile(fd, 0, COPY_CHUNK) > 0)
+        ;
+      sys_close(fd);
     }
   } else if (strcmp(argv[0], "fork") == 0) {
     int pid = sys_fork();
@@ -363,6 +514,56 @@ static void execute(int argc, char *argv[]) {
       // continues predictably and we exercise the tested wait path
       sys_wait();
     }
+  } else if (strcmp(argv[0], "thread") == 0) {
+    int t1 = sys_thread_create(thread_test_worker, 0, 0);
+    int t2 = sys_thread_create(thread_test_worker, 0, 0);
+    if (t1 < 0 || t2 < 0) {
+      uputs("thread: create failed\n");
+    }
+    if (t1 >= 0)
+      sys_thread_join(t1, 0);
+    if (t2 >= 0)
+      sys_thread_join(t2, 0);
+    uputs(thread_test_counter >= 2 ? "[thread] joined, counter shared\n"
+                                   : "[thread] joined\n");
+    thread_test_counter = 0;
+  } else if (strcmp(argv[0], "rt") == 0) {
+    // child: 5 jobs of a 0.2M-tick budget every 1M ticks, each ends with sched_yield
+    int pid = sys_fork();
+    if (pid < 0) {
+      uputs("rt: fork failed\n");
+    } else if (pid == 0) {
+      struct sched_attr attr = {200000, 1000000, 1000000, 0, 0};
+      if (sys_sched_setattr(0, &attr) < 0) {
+        uputs("rt: sched_setattr refused\n");
+        sys_exit(1);
+      }
+      for (int job = 0; job < 5; job++) {
+        for (volatile int i = 0; i < 10000; i++)
+          ;
+        sys_sched_yield();
+      }
+      sys_sched_getattr(0, &attr);
+      uputs("[rt] 5 jobs done, deadline misses= ");
+      uput_dec(attr.misses);
+      uputc('\n');
+      sys_exit(0);
+    } else {
+      sys_wait();
+    }
+  } else if (strcmp(argv[0], "stat") == 0) {
+    cmd_stat(argc, argv);
+  } else if (strcmp(argv[0], "sysstat") == 0) {
+    cmd_sysstat(argc, argv);
+  } else if (strcmp(argv[0], "strace") == 0) {
+    cmd_strace(argc, argv);
+  } else if (strcmp(argv[0], "sched") == 0) {
+    char policy[16];
+    if (sys_sched_policy(argc > 1 ? argv[1] : 0, policy, sizeof(policy)) < 0)
+      uputs("sched: unknown policy (rr, mlfq)\n");
+    uputs("scheduling policy: ");
+    uputs(policy);
+    uputc('\n');
   } else if (strcmp(argv[0], "bg") == 0) {
     int pid = sys_fork();
     if (pid < 0) {
@@ -424,27 +625,113 @@ static void execute(int argc, char *argv[]) {
   } else if (strcmp(argv[0], "help") == 0) {
     cmd_help();
   } else {
-    // not a built-in: try xv6-style fork+exec
-    int pid = sys_fork();
+    // not a built-in: spawn the program directly (no fork copy of the shell); it
+    // inherits our stdin/stdout, so inside a pipeline stage it reads/writes the pipes
+    int pid = sys_spawn(argv[0], argv, NULL);
     if (pid < 0) {
-      uputs("fork: failed\n");
-    } else if (pid == 0) {
-      // child: replace image with named program
-      if (sys_exec(argv[0]) < 0) {
-        uputs("exec: failed\n");
-        sys_exit(1);
-      }
+      uputs("exec: failed\n");
     } else {
-      // parent: wait for child to finish
+      // wait for child to finish
       sys_wait();
     }
   }
 }
 
+// ---- pipelines ----
+#define MAX_STAGES 4
+
+/* start one pipeline stage in a forked copy of the shell with stdin/stdout moved to
+ * the pipe ends (-1 = keep the console), so builtins and programs alike run
+ * concurrently with the other stages; returns the child pid or -1. The child closes
+ * every other pipe fd it inherited (next_rd: the next stage's read end), otherwise a
+ * writer would never lose its reader and a reader never see EOF.
+ */
+static int start_stage(int argc, char *argv[], int in_fd, int out_fd, int next_rd) {
+  int pid = sys_fork();
+  if (pid != 0)
+    return pid;
+  if (in_fd >= 0) {
+    sys_dup2(in_fd, 0);
+    sys_close(in_fd);
+  }
+  if (out_fd >= 0) {
+    sys_dup2(out_fd, 1);
+    sys_close(out_fd);
+  }
+  if (next_rd >= 0)
+    sys_close(next_rd);
+  execute(argc, argv);
+  sys_exit(0);
+  return 0; // not reached
+}
+
+static char *find_bar(char *s) {
+  while (*s && *s != '|')
+    s++;
+  return *s ? s : NULL;
+}
+
+// a | b | c: connect the stages with kernel pipes, start them all, then wait
+static void run_pipeline(char *line) {
+  char *stage[MAX_STAGES];
+  int nstages = 0;
+  char *s = line;
+  while (1) {
+    char *bar = find_bar(s);
+    if (bar)
+      *bar = '\0';
+    if (nstages == MAX_STAGES) {
+      uputs("pipe: too many stages\n");
+      return;
+    }
+    stage[nstages] = trim_spaces(s);
+    if (*stage[nstages] == '\0') {
+      uputs("pipe: invalid syntax\n");
+      return;
+    }
+    nstages++;
+    if (!bar)
+      break;
+    s = bar + 1;
+  }
+
+  int running = 0;
+  int in_fd = -1; // read end feeding the next stage
+  for (int i = 0; i < nstages; i++) {
+    char *argv[MAX_ARGS + 1];
+    int argc = parse_args(stage[i], argv, MAX_ARGS);
+    int fds[2] = {-1, -1};
+    if (i + 1 < nstages && sys_pipe(fds) < 0) {
+      uputs("pipe: cannot create pipe\n");
+    } else if (argc == 0) {
+      uputs("pipe: invalid commands\n");
+    } else {
+      int pid = start_stage(argc, argv, in_fd, fds[1], fds[0]);
+      if (pid < 0)
+        uputs("pipe: cannot start stage\n");
+      else
+        running++;
+    }
+    // the stages hold their own references; ours would keep the pipes open
+    if (in_fd >= 0)
+      sys_close(in_fd);
+    if (fds[1] >= 0)
+      sys_close(fds[1]);
+    in_fd = fds[0];
+    if (i + 1 < nstages && in_fd < 0)
+      break;
+  }
+  if (in_fd >= 0)
+    sys_close(in_fd);
+
+  while (running-- > 0)
+    sys_wait();
+}
+
 // shell entry function, will be used as process entrypoint
 void user_shell(void) {
   char line[256];
-  char *argv[MAX_ARGS];
+  char *argv[MAX_ARGS + 1];
 
   (void)sys_getpid(); // touch to avoid unused warning
 
@@ -455,57 +742,11 @@ void user_shell(void) {
     int len = readline(line, sizeof(line));
     if (len <= 0)
       continue;
-    // check for simple pipeline: cmd1 | cmd2
-    char *pipe_pos = 0;
-    for (int i = 0; line[i]; i++) {
-      if (line[i] == '|') {
-        pipe_pos = &line[i];
-        break;
-      }
-    }
-
-    if (!pipe_pos) {
+    if (!find_bar(line)) {
       int argc = parse_args(line, argv, MAX_ARGS);
       execute(argc, argv);
     } else {
-      *pipe_pos = '\0';
-      char *left = trim_spaces(line);
-      char *right = trim_spaces(pipe_pos + 1);
-
-      if (*left == '\0' || *right == '\0') {
-        uputs("pipe: invalid syntax\n");
-        continue;
-      }
-
-      // first run left side, redirecting shell output to temp file
-      char *argv1[MAX_ARGS];
-      char *argv2[MAX_ARGS];
-      int argc1 = parse_args(left, argv1, MAX_ARGS);
-      int argc2 = parse_args(right, argv2, MAX_ARGS);
-      if (argc1 == 0 || argc2 == 0) {
-        uputs("pipe: invalid commands\n");
-        continue;
-      }
-
-      // prepare temp file for pipe output
-      sys_trunc(pipe_input_name);
-      // Prefer opening without create; if it does not exist, create it to avoid fs_create failure
-      int pfd = sys_open(pipe_input_name, 0);
-      if (pfd < 0)
-        pfd = sys_open(pipe_input_name, 1);
-      if (pfd < 0) {
-        uputs("pipe: cannot open temp file\n");
-        continue;
-      }
-      shell_out_fd = pfd;
-      execute(argc1, argv1);
-      shell_out_fd = -1;
-      sys_close(pfd);
-
-      // second run right side, letting cmd_cat/read/write etc. read from the pipe temp file
-      pipe_input_active = 1;
-      execute(argc2, argv2);
-      pipe_input_active = 0;
+      run_pipeline(line);
     }
   }
 }
@@ -0,0 +1,45 @@
+/*
+ * Lrix
+ * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+ *
+ * This program is released under the terms of the GNU General Public License version 2(GPLv2).
+ * See https://opensource.org/licenses/GPL-2.0 for more information.
+ *
+ * Project homepage: https://github.com/lrisguan/Lrix
+ * Description: A scratch implemention of OS based on RISC-V
+ */
+
+// uclock.c - time without a syscall, on the clock data page (kernel/syscall/vclock.h)
+
+#include "user.h"
+
+// fetched on first use; the page is the same for every process
+static const struct vclock *vclock;
+
+static const struct vclock *uclock_page(void) {
+  if (!vclock)
+    vclock = sys_vclock();
+  return vclock;
+}
+
+uint64_t uclock_ticks(void) {
+  uint64_t t;
+  asm volatile("rdtime %0" : "=r"(t));
+  return t;
+}
+
+uint64_t uclock_freq(void) { return uclock_page()->freq; }
+
+uint64_t uclock_ns(void) {
+  const struct vclock *vc = uclock_page();
+  return (uint64_t)(((unsigned __int128)uclock_ticks() * vc->mult) >> vc->shift);
+}
+
+int uclock_gettime(int clock, struct timespec *ts) {
+  if (!ts || (clock != CLOCK_MONOTONIC && clock != CLOCK_BOOTTIME))
+    return -1;
+  uint64_t ns = uclock_ns();
+  ts->tv_sec = (int64_t)(ns / NSEC_PER_SEC);
+  ts->tv_nsec = (int64_t)(ns % NSEC_PER_SEC);
+  return 0;
+}
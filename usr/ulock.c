@@ -0,0 +1,78 @@
+/*
+ * Lrix
+ * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+ * 
+ * This program is released under the terms of the GNU General Public License version 2(GPLv2).
+ * See https://opensource.org/licenses/GPL-2.0 for more information.
+ * 
+ * Project homepage: https://github.com/lrisguan/Lrix
+ * Description: A scratch implemention of OS based on RISC-V
+ */
+
+
+// ulock.c - futex-based mutex and condition variable for user programs
+
+#include "user.h"
+
+void umutex_init(umutex_t *m) { m->state = 0; }
+
+void umutex_lock(umutex_t *m) {
+  uint32_t c = 0;
+  // fast path: 0 -> 1 without a syscall
+  if (__atomic_compare_exchange_n(&m->state, &c, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    return;
+  // contended: mark the lock as having waiters (2) and sleep until it is released
+  if (c != 2)
+    c = __atomic_exchange_n(&m->state, 2, __ATOMIC_ACQUIRE);
+  while (c != 0) {
+    sys_futex(&m->state, FUTEX_WAIT, 2, 0);
+    c = __atomic_exchange_n(&m->state, 2, __ATOMIC_ACQUIRE);
+  }
+}
+
+int umutex_trylock(umutex_t *m) {
+  uint32_t c = 0;
+  return __atomic_compare_exchange_n(&m->state, &c, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)
+             ? 0
+             : -1;
+}
+
+void umutex_unlock(umutex_t *m) {
+  // 1 -> 0 means nobody waits; otherwise release and wake one sleeper
+  if (__atomic_fetch_sub(&m->state, 1, __ATOMIC_RELEASE) != 1) {
+    __atomic_store_n(&m->state, 0, __ATOMIC_RELEASE);
+    sys_futex(&m->state, FUTEX_WAKE, 1, 0);
+  }
+}
+
+void ucond_init(ucond_t *c) {
+  c->seq = 0;
+  c->m = 0;
+}
+
+void ucond_wait(ucond_t *c, umutex_t *m) {
+  uint32_t seq = __atomic_load_n(&c->seq, __ATOMIC_RELAXED);
+  c->m = m;
+  umutex_unlock(m);
+  // returns at once if a signal bumped seq after we sampled it
+  sys_futex(&c->seq, FUTEX_WAIT, seq, 0);
+  // we may have been requeued onto the mutex: always relock in contended mode so
+  // that our unlock wakes the next requeued waiter
+  while (__atomic_exchange_n(&m->state, 2, __ATOMIC_ACQUIRE) != 0)
+    sys_futex(&m->state, FUTEX_WAIT, 2, 0);
+}
+
+void ucond_signal(ucond_t *c) {
+  __atomic_fetch_add(&c->seq, 1, __ATOMIC_RELEASE);
+  sys_futex(&c->seq, FUTEX_WAKE, 1, 0);
+}
+
+void ucond_broadcast(ucond_t *c) {
+  __atomic_fetch_add(&c->seq, 1, __ATOMIC_RELEASE);
+  // wake one waiter and move the rest straight onto the mutex instead of
+  // waking them all just to contend for it
+  if (c->m)
+    sys_futex(&c->seq, FUTEX_REQUEUE, 1, (uint64_t)(uintptr_t)&c->m->state);
+  else
+    sys_futex(&c->seq, FUTEX_WAKE, 0x7fffffff, 0);
+}
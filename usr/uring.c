@@ -0,0 +1,68 @@
+/*
+ * Lrix
+ * Copyright (C) 2025 lrisguan <lrisguan@outlook.com>
+ *
+ * This program is released under the terms of the GNU General Public License version 2(GPLv2).
+ * See https://opensource.org/licenses/GPL-2.0 for more information.
+ *
+ * Project homepage: https://github.com/lrisguan/Lrix
+ * Description: A scratch implemention of OS based on RISC-V
+ */
+
+// uring.c - queue helpers for the io ring (kernel/syscall/uring.h)
+
+#include "user.h"
+
+struct uring_sqe *uring_get_sqe(struct uring *r) {
+  uint32_t head = __atomic_load_n(&r->sq_head, __ATOMIC_ACQUIRE);
+  if (r->sq_prepared - head >= URING_SQ_ENTRIES)
+    return NULL;
+  struct uring_sqe *sqe = &r->sqes[r->sq_prepared & (URING_SQ_ENTRIES - 1)];
+  r->sq_prepared++;
+  memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+void uring_prep(struct uring_sqe *sqe, int op, int fd, const void *addr, uint64_t len,
+                uint64_t user_data) {
+  sqe->opcode = (uint8_t)op;
+  sqe->fd = fd;
+  sqe->addr = (uint64_t)addr;
+  sqe->len = len;
+  sqe->user_data = user_data;
+}
+
+// publish the prepared sqes and enter the kernel only if someone has to consume them
+static long uring_flush(struct uring *r, uint32_t wait_nr, uint32_t flags) {
+  uint32_t n = r->sq_prepared - r->sq_tail;
+  __atomic_store_n(&r->sq_tail, r->sq_prepared, __ATOMIC_RELEASE);
+  if (r->setup_flags & URING_SETUP_SQPOLL) {
+    if (__atomic_load_n(&r->sq_flags, __ATOMIC_ACQUIRE) & URING_SQ_NEED_WAKEUP)
+      flags |= URING_ENTER_SQ_WAKEUP;
+    if (!flags)
+      return (long)n; // the SQPOLL thread is awake and picks them up: no ecall
+    return sys_uring_enter(0, wait_nr, flags) < 0 ? -1 : (long)n;
+  }
+  // everything not yet consumed, including sqes left over when the CQ was full
+  uint32_t queued = r->sq_tail - __atomic_load_n(&r->sq_head, __ATOMIC_ACQUIRE);
+  if (!queued && !flags)
+    return 0;
+  return sys_uring_enter(queued, wait_nr, flags);
+}
+
+long uring_submit(struct uring *r) { return uring_flush(r, 0, 0); }
+
+long uring_submit_and_wait(struct uring *r, uint32_t wait_nr) {
+  return uring_flush(r, wait_nr, URING_ENTER_GETEVENTS);
+}
+
+struct uring_cqe *uring_peek_cqe(struct uring *r) {
+  uint32_t head = r->cq_head;
+  if (head == __atomic_load_n(&r->cq_tail, __ATOMIC_ACQUIRE))
+    return NULL;
+  return &r->cqes[head & (URING_CQ_ENTRIES - 1)];
+}
+
+void uring_cqe_seen(struct uring *r) {
+  __atomic_store_n(&r->cq_head, r->cq_head + 1, __ATOMIC_RELEASE);
+}
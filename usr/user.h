@@ -14,44 +14,59 @@
 #ifndef _USER_H_
 #define _USER_H_
 
+#include "../kernel/fs/file.h"
 #include "../kernel/fs/fs.h"
+#include "../kernel/fs/poll.h"
+#include "../kernel/proc/futex.h"
 #include "../kernel/string/string.h"
 #include "../kernel/syscall/syscall.h"
+#include "../kernel/syscall/uring.h"
+#include "../kernel/syscall/vclock.h"
 #include <stdint.h>
 
-// generic syscall helper (defined in sys_call.c)
-uint64_t sys_call3(uint64_t num, uint64_t a0, uint64_t a1, uint64_t a2);
+// thread start routine for sys_thread_create
+typedef void *(*thread_fn)(void *);
 
-// syscall wrappers
-void sys_exit(int code);
-int sys_getpid(void);
-long sys_sleep(unsigned long ticks);
-long sys_write(int fd, const void *buf, uint64_t len);
-int sys_open(const char *name, int create);
-long sys_read(int fd, void *buf, uint64_t len);
-int sys_close(int fd);
-int sys_ls(struct dirent *ents, int max_ents);
-int sys_getc(void);
-int sys_unlink(const char *name);
-int sys_fork(void);
-int sys_wait(void);
+// static inline sys_*() wrappers, generated from kernel/syscall/syscall.tbl
+#include "usyscall.h"
 
-// kill process by pid
-int sys_kill(int pid);
+// user-space mutex / condition variable built on futex (ulock.c):
+// uncontended lock/unlock never enter the kernel, contended waiters sleep
+typedef struct {
+  volatile uint32_t state; // 0 = unlocked, 1 = locked, 2 = locked with waiters
+} umutex_t;
 
-// exec: replace current process with named program (does not return on success)
-int sys_exec(const char *name);
+typedef struct {
+  volatile uint32_t seq; // bumped by every signal/broadcast
+  umutex_t *m;           // mutex used by waiters, target of broadcast requeue
+} ucond_t;
 
-// truncate file by name (size -> 0)
-int sys_trunc(const char *name);
+void umutex_init(umutex_t *m);
+void umutex_lock(umutex_t *m);
+int umutex_trylock(umutex_t *m);
+void umutex_unlock(umutex_t *m);
+void ucond_init(ucond_t *c);
+void ucond_wait(ucond_t *c, umutex_t *m);
+void ucond_signal(ucond_t *c);
+void ucond_broadcast(ucond_t *c);
 
-// list processes (ps)
-int sys_ps(void);
+// io ring helpers (uring.c) on the page from sys_uring_setup: get_sqe returns the next
+// free sqe (NULL if the SQ is full), submit publishes the prepared sqes (entering the
+// kernel only when needed) and returns how many, peek_cqe returns the oldest unreaped
+// cqe or NULL, cqe_seen releases it
+struct uring_sqe *uring_get_sqe(struct uring *r);
+void uring_prep(struct uring_sqe *sqe, int op, int fd, const void *addr, uint64_t len,
+                uint64_t user_data);
+long uring_submit(struct uring *r);
+long uring_submit_and_wait(struct uring *r, uint32_t wait_nr);
+struct uring_cqe *uring_peek_cqe(struct uring *r);
+void uring_cqe_seen(struct uring *r);
 
-// shutdown / halt the whole system (does not return)
-void sys_shutdown(void);
-
-// suspend current process into blocked state (used by bg worker)
-void sys_suspend(void);
+// clock helpers (uclock.c): read the time CSR and convert with the clock data page,
+// no ecall per call. ticks are mtime ticks (uclock_freq per second)
+uint64_t uclock_ticks(void);
+uint64_t uclock_freq(void);
+uint64_t uclock_ns(void);
+int uclock_gettime(int clock, struct timespec *ts);
 
 #endif /* _USER_H_ */